@@ -0,0 +1,167 @@
+#include "alloc_tracking.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace alloc_tracking {
+namespace {
+// Every block starts with its size, so frees are accounted in bytes too,
+// even unsized ones and frees of memory allocated before a Scope.
+struct Header {
+  std::size_t size;
+  std::size_t offset; // from the start of the allocation to the user pointer
+};
+
+constexpr std::size_t header_space =
+    std::max(sizeof(Header), std::size_t(__STDCPP_DEFAULT_NEW_ALIGNMENT__));
+
+// no constructor or destructor, so it is usable while the thread starts
+// and exits
+struct State {
+  std::uint64_t allocations;
+  std::uint64_t frees;
+  std::uint64_t bytes_allocated;
+  std::uint64_t bytes_freed;
+  std::int64_t live_bytes;
+  std::int64_t peak_live_bytes;
+};
+
+thread_local State state;
+
+Header *header(void *ptr) noexcept {
+  return reinterpret_cast<Header *>(static_cast<unsigned char *>(ptr) -
+                                    sizeof(Header));
+}
+
+void *tryAllocate(std::size_t size, std::size_t alignment) noexcept {
+  std::size_t offset = std::max(header_space, alignment);
+  if (size > std::size_t(-1) - 2 * offset)
+    return nullptr;
+  void *base;
+  if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    base = std::malloc(offset + size);
+  else
+    base = std::aligned_alloc(offset, (offset + size + offset - 1) / offset *
+                                          offset);
+  if (!base)
+    return nullptr;
+
+  void *ptr = static_cast<unsigned char *>(base) + offset;
+  *header(ptr) = Header{size, offset};
+  auto &s = state;
+  ++s.allocations;
+  s.bytes_allocated += size;
+  s.live_bytes += static_cast<std::int64_t>(size);
+  if (s.live_bytes > s.peak_live_bytes)
+    s.peak_live_bytes = s.live_bytes;
+  return ptr;
+}
+
+void *allocate(std::size_t size, std::size_t alignment) {
+  for (;;) {
+    if (void *ptr = tryAllocate(size, alignment))
+      return ptr;
+    auto handler = std::get_new_handler();
+    if (!handler)
+      throw std::bad_alloc();
+    handler();
+  }
+}
+
+void *allocateNoThrow(std::size_t size, std::size_t alignment) noexcept {
+  try {
+    return allocate(size, alignment);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void deallocate(void *ptr) noexcept {
+  if (!ptr)
+    return;
+  Header h = *header(ptr);
+  auto &s = state;
+  ++s.frees;
+  s.bytes_freed += h.size;
+  s.live_bytes -= static_cast<std::int64_t>(h.size);
+  std::free(static_cast<unsigned char *>(ptr) - h.offset);
+}
+} // namespace
+
+Totals totals() noexcept {
+  auto &s = state;
+  return Totals{s.allocations, s.frees,      s.bytes_allocated,
+                s.bytes_freed, s.live_bytes, s.peak_live_bytes};
+}
+
+std::int64_t restartPeak() noexcept {
+  auto &s = state;
+  return std::exchange(s.peak_live_bytes, s.live_bytes);
+}
+
+void mergePeak(std::int64_t peak) noexcept {
+  auto &s = state;
+  s.peak_live_bytes = std::max(s.peak_live_bytes, peak);
+}
+} // namespace alloc_tracking
+
+using alloc_tracking::allocate;
+using alloc_tracking::allocateNoThrow;
+using alloc_tracking::deallocate;
+
+void *operator new(std::size_t size) { return allocate(size, 0); }
+void *operator new[](std::size_t size) { return allocate(size, 0); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return allocateNoThrow(size, 0);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return allocateNoThrow(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return allocate(size, std::size_t(alignment));
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return allocate(size, std::size_t(alignment));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  return allocateNoThrow(size, std::size_t(alignment));
+}
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  return allocateNoThrow(size, std::size_t(alignment));
+}
+
+void operator delete(void *ptr) noexcept { deallocate(ptr); }
+void operator delete[](void *ptr) noexcept { deallocate(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { deallocate(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { deallocate(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  deallocate(ptr);
+}
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  deallocate(ptr);
+}
+void operator delete(void *ptr, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+  deallocate(ptr);
+}
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+  deallocate(ptr);
+}
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept {
+  deallocate(ptr);
+}
+void operator delete(void *ptr, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  deallocate(ptr);
+}
+void operator delete[](void *ptr, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  deallocate(ptr);
+}
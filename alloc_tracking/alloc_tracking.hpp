@@ -0,0 +1,210 @@
+#pragma once
+
+// Allocation accounting for tests and benchmarks. Linking
+// single_thread_shared_ptr_alloc_tracking replaces the global operator new
+// and delete (all forms) with versions that count the calls and bytes of
+// the calling thread, so a program may link it only once and must not
+// replace them itself.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace alloc_tracking {
+
+/// Allocations of one thread while a Scope was active
+struct Counts {
+  std::uint64_t allocations{0};
+  std::uint64_t frees{0};
+  std::uint64_t bytes_allocated{0};
+  std::uint64_t bytes_freed{0};
+  std::int64_t peak_live_bytes{0}; // above the live bytes at the start
+
+  Counts &operator+=(const Counts &rhs) noexcept {
+    allocations += rhs.allocations;
+    frees += rhs.frees;
+    bytes_allocated += rhs.bytes_allocated;
+    bytes_freed += rhs.bytes_freed;
+    if (rhs.peak_live_bytes > peak_live_bytes)
+      peak_live_bytes = rhs.peak_live_bytes;
+    return *this;
+  }
+};
+
+/// Totals of the calling thread since it started
+struct Totals {
+  std::uint64_t allocations;
+  std::uint64_t frees;
+  std::uint64_t bytes_allocated;
+  std::uint64_t bytes_freed;
+  std::int64_t live_bytes; // negative when memory of other threads was freed
+  std::int64_t peak_live_bytes;
+};
+
+Totals totals() noexcept;
+
+// restarts the peak at the current live bytes, returns the old peak
+std::int64_t restartPeak() noexcept;
+
+// the peak is the larger of the current one and peak
+void mergePeak(std::int64_t peak) noexcept;
+
+/// Counts the allocations of the calling thread from its construction to
+/// counts() / its destruction. Scopes may nest.
+class Scope {
+public:
+  Scope() noexcept : _start{totals()}, _outer_peak{restartPeak()} {}
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+  ~Scope() { mergePeak(_outer_peak); }
+
+  Counts counts() const noexcept {
+    auto now = totals();
+    Counts c;
+    c.allocations = now.allocations - _start.allocations;
+    c.frees = now.frees - _start.frees;
+    c.bytes_allocated = now.bytes_allocated - _start.bytes_allocated;
+    c.bytes_freed = now.bytes_freed - _start.bytes_freed;
+    c.peak_live_bytes = now.peak_live_bytes - _start.live_bytes;
+    return c;
+  }
+
+private:
+  Totals _start;
+  std::int64_t _outer_peak;
+};
+
+/// Allocations made by c()
+template <typename Callable> Counts measure(Callable &&c) {
+  Scope scope;
+  std::forward<Callable>(c)();
+  return scope.counts();
+}
+
+/// Most allocations a scenario may make per operation, checked by Report
+struct Budget {
+  double allocations;
+};
+
+struct Result {
+  std::string name;
+  std::string implementation;
+  std::size_t operations;
+  Counts counts;
+  Budget budget;
+
+  double perOperation(std::uint64_t value) const noexcept {
+    return double(value) / double(operations);
+  }
+
+  bool withinBudget() const noexcept {
+    return perOperation(counts.allocations) <= budget.allocations;
+  }
+};
+
+/// Runs allocation scenarios and reports them as text on stderr and as
+/// JSON, like bench::Runner does for timings.
+///   --output=FILE       write JSON to FILE instead of stdout
+///   --filter=TEXT       run only scenarios whose name contains TEXT
+/// finish() fails when a scenario allocated more than its budget.
+class Report {
+public:
+  Report(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg.compare(0, 9, "--output=") == 0)
+        _output = arg.substr(9);
+      else if (arg.compare(0, 9, "--filter=") == 0)
+        _filter = arg.substr(9);
+      else {
+        std::fprintf(stderr, "usage: %s [--output=FILE] [--filter=TEXT]\n",
+                     argv[0]);
+        std::exit(arg == "--help" ? 0 : 1);
+      }
+    }
+  }
+
+  /// c(n) performs n operations. It runs once untracked first, so thread
+  /// local caches and free lists are warm.
+  template <typename Callable>
+  void run(const std::string &name, const std::string &implementation,
+           std::size_t operations, Budget budget, Callable &&c) {
+    if (!_filter.empty() && name.find(_filter) == std::string::npos)
+      return;
+
+    c(operations);
+    auto counts = measure([&] { c(operations); });
+    Result r{name, implementation, operations, counts, budget};
+    std::fprintf(stderr, "%-24s %-36s %8.2f allocs/op %8.2f frees/op %10.1f "
+                         "bytes/op %10lld peak bytes%s\n",
+                 name.c_str(), implementation.c_str(),
+                 r.perOperation(counts.allocations),
+                 r.perOperation(counts.frees),
+                 r.perOperation(counts.bytes_allocated),
+                 static_cast<long long>(counts.peak_live_bytes),
+                 r.withinBudget() ? "" : "  OVER BUDGET");
+    _results.push_back(std::move(r));
+  }
+
+  const std::vector<Result> &results() const noexcept { return _results; }
+
+  /// Write the results as JSON, returns the process exit code
+  int finish() const {
+    std::FILE *out = _output.empty() ? stdout : std::fopen(_output.c_str(), "w");
+    if (!out) {
+      std::perror(_output.c_str());
+      return 1;
+    }
+
+    bool within = true;
+    std::fprintf(out, "{\n  \"allocations\": [");
+    for (std::size_t i = 0; i < _results.size(); ++i) {
+      const auto &r = _results[i];
+      within = within && r.withinBudget();
+      std::fprintf(
+          out,
+          "%s\n    {\"name\": \"%s\", \"implementation\": \"%s\", "
+          "\"operations\": %zu, \"allocations\": %llu, \"frees\": %llu, "
+          "\"bytes_allocated\": %llu, \"bytes_freed\": %llu, "
+          "\"peak_live_bytes\": %lld, \"budget_allocations_per_op\": %g, "
+          "\"within_budget\": %s}",
+          i ? "," : "", escape(r.name).c_str(),
+          escape(r.implementation).c_str(), r.operations,
+          static_cast<unsigned long long>(r.counts.allocations),
+          static_cast<unsigned long long>(r.counts.frees),
+          static_cast<unsigned long long>(r.counts.bytes_allocated),
+          static_cast<unsigned long long>(r.counts.bytes_freed),
+          static_cast<long long>(r.counts.peak_live_bytes),
+          r.budget.allocations, r.withinBudget() ? "true" : "false");
+    }
+    std::fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout)
+      std::fclose(out);
+    if (!within)
+      std::fprintf(stderr, "allocation budget exceeded\n");
+    return within ? 0 : 1;
+  }
+
+private:
+  static std::string escape(const std::string &s) {
+    std::string escaped;
+    for (char c : s) {
+      if (c == '"' || c == '\\')
+        escaped += '\\';
+      escaped += c;
+    }
+    return escaped;
+  }
+
+  std::string _output;
+  std::string _filter;
+  std::vector<Result> _results;
+};
+
+} // namespace alloc_tracking
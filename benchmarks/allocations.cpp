@@ -0,0 +1,199 @@
+#include <alloc_tracking.hpp>
+
+#include <single_thread_shared_ptr/single_thread_compact_ptr.hpp>
+#include <single_thread_shared_ptr/single_thread_local_shared_ptr.hpp>
+#include <single_thread_shared_ptr/single_thread_shared_pool.hpp>
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Allocations, frees, bytes and peak live bytes per operation of the common
+// pointer operations. Every scenario has a budget of allocations per
+// operation and the program fails when one is exceeded, so a change which
+// makes an operation allocate more breaks the build step running it.
+
+namespace {
+struct Object {
+  explicit Object(int v) : value{v} {}
+  int value;
+  char payload[24]{};
+};
+
+constexpr std::size_t operations = 1000;
+
+void create(alloc_tracking::Report &report) {
+  using ptr = single_thread_shared_ptr<Object>;
+  std::vector<ptr> keep;
+  keep.reserve(operations);
+
+  // objects are kept until the end, so the peak shows the memory they use
+  auto fill = [&](std::size_t n, auto &&make) {
+    for (std::size_t i = 0; i < n; ++i)
+      keep.push_back(make(int(i)));
+    keep.clear();
+  };
+
+  report.run("create", "single_thread_shared_ptr(new)", operations, {1},
+             [&](std::size_t n) {
+               fill(n, [](int v) { return ptr(new Object(v)); });
+             });
+
+  report.run("create", "make_single_thread_shared", operations, {1},
+             [&](std::size_t n) {
+               fill(n, [](int v) { return make_single_thread_shared<Object>(v); });
+             });
+
+  // the untracked first run fills the free list, the measured one reuses it
+  single_thread_shared_pool<Object> pool(operations);
+  report.run("create", "single_thread_shared_pool::make", operations, {0},
+             [&](std::size_t n) {
+               fill(n, [&pool](int v) { return pool.make(v); });
+             });
+
+  std::vector<std::shared_ptr<Object>> keep_std;
+  keep_std.reserve(operations);
+  auto fill_std = [&](std::size_t n, auto &&make) {
+    for (std::size_t i = 0; i < n; ++i)
+      keep_std.push_back(make(int(i)));
+    keep_std.clear();
+  };
+
+  report.run("create", "std::shared_ptr(new)", operations, {2},
+             [&](std::size_t n) {
+               fill_std(n, [](int v) {
+                 return std::shared_ptr<Object>(new Object(v));
+               });
+             });
+
+  report.run("create", "std::make_shared", operations, {1},
+             [&](std::size_t n) {
+               fill_std(n, [](int v) { return std::make_shared<Object>(v); });
+             });
+
+  std::vector<single_thread_compact_ptr<Object>> keep_compact;
+  keep_compact.reserve(operations);
+  report.run("create", "make_single_thread_compact", operations, {1},
+             [&](std::size_t n) {
+               for (std::size_t i = 0; i < n; ++i)
+                 keep_compact.push_back(
+                     make_single_thread_compact<Object>(int(i)));
+               keep_compact.clear();
+             });
+
+  std::vector<single_thread_local_shared_ptr<Object>> keep_local;
+  keep_local.reserve(operations);
+  report.run("create", "make_single_thread_local_shared", operations, {1},
+             [&](std::size_t n) {
+               for (std::size_t i = 0; i < n; ++i)
+                 keep_local.push_back(
+                     make_single_thread_local_shared<Object>(int(i)));
+               keep_local.clear();
+             });
+}
+
+// owners and weak references added to existing objects
+void copy(alloc_tracking::Report &report) {
+  // a new object gets a second owner right away
+  report.run("share_new_object", "single_thread_shared_ptr(new)", operations,
+             {2}, [](std::size_t n) {
+               for (std::size_t i = 0; i < n; ++i) {
+                 single_thread_shared_ptr<Object> owner(new Object(1));
+                 auto c = owner;
+               }
+             });
+
+  report.run("share_new_object", "make_single_thread_shared", operations, {1},
+             [](std::size_t n) {
+               for (std::size_t i = 0; i < n; ++i) {
+                 auto owner = make_single_thread_shared<Object>(1);
+                 auto c = owner;
+               }
+             });
+
+  report.run("share_new_object", "std::shared_ptr(new)", operations, {2},
+             [](std::size_t n) {
+               for (std::size_t i = 0; i < n; ++i) {
+                 std::shared_ptr<Object> owner(new Object(1));
+                 auto c = owner;
+               }
+             });
+
+  report.run("share_new_object", "std::make_shared", operations, {1},
+             [](std::size_t n) {
+               for (std::size_t i = 0; i < n; ++i) {
+                 auto owner = std::make_shared<Object>(1);
+                 auto c = owner;
+               }
+             });
+
+  // owners which were shared before
+  single_thread_shared_ptr<Object> owner(new Object(1));
+  { auto first = owner; }
+  auto made = make_single_thread_shared<Object>(1);
+  auto std_owner = std::make_shared<Object>(1);
+
+  report.run("copy_again", "single_thread_shared_ptr(new)", operations, {0},
+             [&](std::size_t n) {
+               for (std::size_t i = 0; i < n; ++i)
+                 auto c = owner;
+             });
+
+  report.run("copy_again", "make_single_thread_shared", operations, {0},
+             [&](std::size_t n) {
+               for (std::size_t i = 0; i < n; ++i)
+                 auto c = made;
+             });
+
+  report.run("copy_again", "std::shared_ptr", operations, {0},
+             [&](std::size_t n) {
+               for (std::size_t i = 0; i < n; ++i)
+                 auto c = std_owner;
+             });
+
+  report.run("weak_reference", "single_thread_shared_ptr(new)", operations,
+             {0}, [&](std::size_t n) {
+               for (std::size_t i = 0; i < n; ++i)
+                 single_thread_weak_ptr<Object> w(owner);
+             });
+
+  report.run("weak_reference", "make_single_thread_shared", operations, {0},
+             [&](std::size_t n) {
+               for (std::size_t i = 0; i < n; ++i)
+                 single_thread_weak_ptr<Object> w(made);
+             });
+
+  report.run("weak_reference", "std::shared_ptr", operations, {0},
+             [&](std::size_t n) {
+               for (std::size_t i = 0; i < n; ++i)
+                 std::weak_ptr<Object> w(std_owner);
+             });
+}
+
+// a container of pointers to shared objects copied as a whole
+void containers(alloc_tracking::Report &report) {
+  std::vector<single_thread_shared_ptr<Object>> objects;
+  std::vector<std::shared_ptr<Object>> std_objects;
+  for (std::size_t i = 0; i < operations; ++i) {
+    objects.push_back(make_single_thread_shared<Object>(int(i)));
+    std_objects.push_back(std::make_shared<Object>(int(i)));
+  }
+
+  // the buffer of the copy is the only allocation, one per operations
+  // elements
+  report.run("vector_copy", "make_single_thread_shared", operations,
+             {1.0 / operations}, [&](std::size_t) { auto copy = objects; });
+
+  report.run("vector_copy", "std::make_shared", operations, {1.0 / operations},
+             [&](std::size_t) { auto copy = std_objects; });
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  alloc_tracking::Report report{argc, argv};
+  create(report);
+  copy(report);
+  containers(report);
+  return report.finish();
+}
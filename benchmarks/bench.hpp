@@ -0,0 +1,179 @@
+#pragma once
+
+// Minimal self contained benchmark harness, so the benchmarks build offline.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// Keep the compiler from optimizing value (and the work producing it) away.
+template <typename T> inline void doNotOptimize(T &value) {
+#if defined(__GNUC__)
+  asm volatile("" : "+m"(value) : : "memory");
+#else
+  static volatile const void *sink;
+  sink = &value;
+#endif
+}
+
+template <typename T> inline void doNotOptimize(const T &value) {
+#if defined(__GNUC__)
+  asm volatile("" : : "m"(value) : "memory");
+#else
+  static volatile const void *sink;
+  sink = &value;
+#endif
+}
+
+/// p-th percentile (0..100) of samples, sorts them
+inline double percentile(std::vector<double> &samples, double p) {
+  if (samples.empty())
+    return 0;
+  std::sort(samples.begin(), samples.end());
+  auto i = static_cast<std::size_t>(p / 100 * double(samples.size() - 1) + 0.5);
+  return samples[std::min(i, samples.size() - 1)];
+}
+
+/// Nanoseconds spent in c()
+template <typename Callable> inline double timed(Callable &&c) {
+  auto begin = std::chrono::steady_clock::now();
+  c();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - begin).count();
+}
+
+struct Result {
+  std::string name;
+  std::string implementation;
+  std::size_t operations;
+  double min_ns;    // per operation, best repetition
+  double median_ns; // per operation, median repetition
+};
+
+/// Runs cases and reports them as text on stderr and as JSON.
+///   --output=FILE       write JSON to FILE instead of stdout
+///   --filter=TEXT       run only cases whose name contains TEXT
+///   --repetitions=N     repetitions per case (default 5)
+///   --scale=X           multiply the operation counts by X (default 1)
+class Runner {
+public:
+  Runner(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (startsWith(arg, "--output="))
+        _output = arg.substr(9);
+      else if (startsWith(arg, "--filter="))
+        _filter = arg.substr(9);
+      else if (startsWith(arg, "--repetitions="))
+        _repetitions = std::max(1, std::atoi(arg.c_str() + 14));
+      else if (startsWith(arg, "--scale="))
+        _scale = std::atof(arg.c_str() + 8);
+      else {
+        std::fprintf(stderr,
+                     "usage: %s [--output=FILE] [--filter=TEXT] "
+                     "[--repetitions=N] [--scale=X]\n",
+                     argv[0]);
+        std::exit(arg == "--help" ? 0 : 1);
+      }
+    }
+  }
+
+  /// Extra key / value pair reported in the JSON context
+  void context(std::string key, std::string value) {
+    _context.emplace_back(std::move(key), std::move(value));
+  }
+
+  /// c(n) performs n operations and returns the nanoseconds they took
+  template <typename Callable>
+  void run(const std::string &name, const std::string &implementation,
+           std::size_t operations, Callable &&c) {
+    if (!_filter.empty() && name.find(_filter) == std::string::npos)
+      return;
+
+    operations = std::max<std::size_t>(1, operations * _scale);
+    c(std::max<std::size_t>(1, operations / 10)); // warm up
+
+    std::vector<double> samples;
+    for (int i = 0; i < _repetitions; ++i)
+      samples.push_back(c(operations) / operations);
+    std::sort(samples.begin(), samples.end());
+
+    _results.push_back(Result{name, implementation, operations, samples.front(),
+                              samples[samples.size() / 2]});
+    std::fprintf(stderr, "%-28s %-36s %10.2f ns/op\n", name.c_str(),
+                 implementation.c_str(), samples[samples.size() / 2]);
+  }
+
+  /// Report a value measured by the caller, e.g. a latency percentile
+  void add(const std::string &name, const std::string &implementation,
+           std::size_t operations, double ns) {
+    if (!_filter.empty() && name.find(_filter) == std::string::npos)
+      return;
+    _results.push_back(Result{name, implementation, operations, ns, ns});
+    std::fprintf(stderr, "%-28s %-36s %10.2f ns\n", name.c_str(),
+                 implementation.c_str(), ns);
+  }
+
+  const std::vector<Result> &results() const noexcept { return _results; }
+
+  /// Write the results as JSON, returns the process exit code
+  int finish() const {
+    std::FILE *out = _output.empty() ? stdout : std::fopen(_output.c_str(), "w");
+    if (!out) {
+      std::perror(_output.c_str());
+      return 1;
+    }
+
+    std::fprintf(out, "{\n  \"context\": {\n");
+    std::fprintf(out, "    \"repetitions\": %d,\n    \"scale\": %g", _repetitions,
+                 _scale);
+    for (const auto &[key, value] : _context)
+      std::fprintf(out, ",\n    \"%s\": \"%s\"", escape(key).c_str(),
+                   escape(value).c_str());
+    std::fprintf(out, "\n  },\n  \"benchmarks\": [");
+    for (std::size_t i = 0; i < _results.size(); ++i) {
+      const auto &r = _results[i];
+      std::fprintf(out,
+                   "%s\n    {\"name\": \"%s\", \"implementation\": \"%s\", "
+                   "\"operations\": %zu, \"min_ns\": %.3f, \"median_ns\": %.3f}",
+                   i ? "," : "", escape(r.name).c_str(),
+                   escape(r.implementation).c_str(), r.operations, r.min_ns,
+                   r.median_ns);
+    }
+    std::fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout)
+      std::fclose(out);
+    return 0;
+  }
+
+private:
+  static bool startsWith(const std::string &s, const char *prefix) {
+    return s.compare(0, std::strlen(prefix), prefix) == 0;
+  }
+
+  static std::string escape(const std::string &s) {
+    std::string escaped;
+    for (char c : s) {
+      if (c == '"' || c == '\\')
+        escaped += '\\';
+      escaped += c;
+    }
+    return escaped;
+  }
+
+  std::string _output;
+  std::string _filter;
+  int _repetitions{5};
+  double _scale{1.0};
+  std::vector<std::pair<std::string, std::string>> _context;
+  std::vector<Result> _results;
+};
+
+} // namespace bench
@@ -0,0 +1,108 @@
+#include "bench.hpp"
+
+#include <single_thread_shared_ptr/single_thread_compact_ptr.hpp>
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+struct Object {
+  explicit Object(int v) : value{v} {}
+  int value;
+};
+
+struct TwoWords {
+  static constexpr const char *name = "make_single_thread_shared";
+  using ptr = single_thread_shared_ptr<Object>;
+  static ptr make(int v) { return make_single_thread_shared<Object>(v); }
+  // pointer plus its allocation (object and control block)
+  static constexpr std::size_t bytes =
+      sizeof(ptr) + sizeof(single_thread_shared_ptr_inplace_block<Object>);
+};
+
+struct OneWord {
+  static constexpr const char *name = "make_single_thread_compact";
+  using ptr = single_thread_compact_ptr<Object>;
+  static ptr make(int v) { return make_single_thread_compact<Object>(v); }
+  static constexpr std::size_t bytes =
+      sizeof(ptr) + single_thread_compact_block<Object>::offset() +
+      sizeof(Object);
+};
+
+// an index holding many pointers, most of them never copied
+constexpr std::size_t elements = 1'000'000;
+
+template <typename P> void suite(bench::Runner &runner) {
+  using ptr = typename P::ptr;
+
+  runner.context(std::string("bytes_per_element ") + P::name,
+                 std::to_string(P::bytes));
+
+  auto fill = [](std::vector<ptr> &v, std::size_t n) {
+    std::mt19937 random{42};
+    for (std::size_t i = 0; i < n; ++i)
+      v.push_back(P::make(int(random())));
+  };
+
+  runner.run("index_fill", P::name, elements, [&](std::size_t n) {
+    std::vector<ptr> v;
+    return bench::timed([&] {
+      fill(v, n);
+      bench::doNotOptimize(v);
+    });
+  });
+
+  runner.run("index_copy", P::name, elements, [&](std::size_t n) {
+    std::vector<ptr> v;
+    fill(v, n);
+    return bench::timed([&] {
+      std::vector<ptr> copy = v;
+      bench::doNotOptimize(copy);
+    });
+  });
+
+  runner.run("index_scan", P::name, elements, [&](std::size_t n) {
+    std::vector<ptr> v;
+    fill(v, n);
+    return bench::timed([&] {
+      long sum = 0;
+      for (const auto &p : v)
+        sum += p->value;
+      bench::doNotOptimize(sum);
+    });
+  });
+
+  runner.run("index_sort", P::name, elements, [&](std::size_t n) {
+    std::vector<ptr> v;
+    fill(v, n);
+    return bench::timed([&] {
+      std::sort(v.begin(), v.end(),
+                [](const ptr &a, const ptr &b) { return a->value < b->value; });
+    });
+  });
+
+  runner.run("index_destroy", P::name, elements, [&](std::size_t n) {
+    std::vector<ptr> v;
+    fill(v, n);
+    return bench::timed([&] {
+      v.clear();
+      v.shrink_to_fit();
+    });
+  });
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  bench::Runner runner{argc, argv};
+  runner.context("sizeof single_thread_shared_ptr",
+                 std::to_string(sizeof(TwoWords::ptr)));
+  runner.context("sizeof single_thread_compact_ptr",
+                 std::to_string(sizeof(OneWord::ptr)));
+
+  suite<TwoWords>(runner);
+  suite<OneWord>(runner);
+  return runner.finish();
+}
@@ -0,0 +1,107 @@
+#include "bench.hpp"
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+#ifdef SINGLE_THREAD_SHARED_PTR_COUNTER_POOL
+constexpr const char *allocator = "thread local pool";
+#else
+constexpr const char *allocator = "operator new";
+#endif
+
+constexpr std::size_t iterations = 10'000'000;
+} // namespace
+
+int main(int argc, char **argv) {
+  bench::Runner runner{argc, argv};
+
+  // a copy of a sole owner promotes the counter, dropping the copies
+  // releases it again
+  runner.run("promote_release", allocator, iterations, [](std::size_t n) {
+    return bench::timed([&] {
+      for (std::size_t i = 0; i < n; ++i) {
+        single_thread_shared_ptr_counter c1;
+        single_thread_shared_ptr_counter c2{c1};
+        bench::doNotOptimize(c1);
+        bench::doNotOptimize(c2);
+      }
+    });
+  });
+
+  int value = 0;
+  runner.run("copy_of_unique_pointer", allocator, iterations,
+             [&](std::size_t n) {
+               return bench::timed([&] {
+                 for (std::size_t i = 0; i < n; ++i) {
+                   single_thread_shared_ptr<int> p(new int(value));
+                   auto copy = p;
+                   bench::doNotOptimize(copy);
+                 }
+               });
+             });
+
+  // many counters alive at once, released in the allocation order
+  runner.run("promote_release_batch", allocator, iterations,
+             [](std::size_t n) {
+               std::vector<single_thread_shared_ptr_counter> owners(1024);
+               std::vector<single_thread_shared_ptr_counter> copies;
+               copies.reserve(owners.size());
+               return bench::timed([&] {
+                 for (std::size_t i = 0; i < n; i += owners.size()) {
+                   for (auto &o : owners)
+                     copies.emplace_back(o);
+                   bench::doNotOptimize(copies);
+                   copies.clear();
+                   for (auto &o : owners)
+                     o = single_thread_shared_ptr_counter{};
+                 }
+               });
+             });
+
+  // pointers shared for a moment and then kept alone, like cache entries
+  // scanned for the ones nobody else holds; the scan gives survivors of a
+  // copy their inline count back
+  constexpr std::size_t survivors = 1'000'000;
+  for (bool shared : {false, true}) {
+    std::string name =
+        std::string(allocator) + (shared ? ", briefly shared" : ", never shared");
+    auto fill = [shared](std::vector<single_thread_shared_ptr<int>> &v) {
+      for (std::size_t i = 0; i < survivors; ++i) {
+        v.emplace_back(new int(int(i)));
+        if (shared) {
+          auto copy = v.back();
+          bench::doNotOptimize(copy);
+        }
+      }
+    };
+
+    runner.run("survivor_scan", name, survivors * 10, [&](std::size_t n) {
+      std::vector<single_thread_shared_ptr<int>> v;
+      v.reserve(survivors);
+      fill(v);
+      std::size_t alone = 0;
+      return bench::timed([&] {
+        for (std::size_t done = 0; done < n; done += survivors)
+          for (auto &p : v)
+            alone += p.reclaim_counter();
+        bench::doNotOptimize(alone);
+      });
+    });
+
+    runner.run("survivor_destroy", name, survivors, [&](std::size_t n) {
+      double ns = 0;
+      for (std::size_t done = 0; done < n; done += survivors) {
+        std::vector<single_thread_shared_ptr<int>> v;
+        v.reserve(survivors);
+        fill(v);
+        ns += bench::timed([&] { v.clear(); });
+      }
+      return ns;
+    });
+  }
+
+  return runner.finish();
+}
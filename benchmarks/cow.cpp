@@ -0,0 +1,120 @@
+#include "bench.hpp"
+
+#include <single_thread_shared_ptr/single_thread_cow.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+// a service configuration, large enough that copying it shows
+struct Config {
+  std::vector<std::string> hosts;
+  std::vector<int> limits;
+  std::string region;
+  int timeout_ms{100};
+};
+
+Config makeConfig() {
+  Config c;
+  for (int i = 0; i < 32; ++i)
+    c.hosts.push_back("host-" + std::to_string(i) + ".example.internal");
+  c.limits.assign(256, 10);
+  c.region = "eu-west";
+  return c;
+}
+
+// every request gets an overlay of the base configuration, one in
+// overlay_every requests changes a setting, the others only read
+constexpr std::size_t requests = 1'000'000;
+constexpr std::size_t overlay_every = 10;
+
+template <typename Overlay, typename Read, typename Write>
+double serve(std::size_t n, Overlay &&overlay, Read &&read, Write &&write) {
+  long sum = 0;
+  double seconds = bench::timed([&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      auto config = overlay();
+      if (i % overlay_every == 0)
+        write(config, int(i));
+      sum += read(config);
+    }
+  });
+  bench::doNotOptimize(sum);
+  return seconds;
+}
+
+void suite(bench::Runner &runner) {
+  const Config base = makeConfig();
+
+  runner.run("request_overlay", "copy of the struct", requests,
+             [&](std::size_t n) {
+               return serve(
+                   n, [&] { return base; },
+                   [](const Config &c) { return long(c.timeout_ms); },
+                   [](Config &c, int v) { c.timeout_ms = v; });
+             });
+
+  // the usual hand written copy on write: the overlay shares the base until
+  // it changes, then copies it into a new std::shared_ptr
+  auto shared_base = std::make_shared<const Config>(base);
+  runner.run("request_overlay", "std::shared_ptr<const> copied on change",
+             requests, [&](std::size_t n) {
+               return serve(
+                   n, [&] { return shared_base; },
+                   [](const std::shared_ptr<const Config> &c) {
+                     return long(c->timeout_ms);
+                   },
+                   [](std::shared_ptr<const Config> &c, int v) {
+                     auto copy = std::make_shared<Config>(*c);
+                     copy->timeout_ms = v;
+                     c = std::move(copy);
+                   });
+             });
+
+  single_thread_cow<Config> cow_base(base);
+  runner.run("request_overlay", "single_thread_cow", requests,
+             [&](std::size_t n) {
+               return serve(
+                   n, [&] { return cow_base; },
+                   [](const single_thread_cow<Config> &c) {
+                     return long(c->timeout_ms);
+                   },
+                   [](single_thread_cow<Config> &c, int v) {
+                     c.write().timeout_ms = v;
+                   });
+             });
+
+  // many writes to a value nobody shares, each one checks uniqueness
+  runner.run("unique_writes", "single_thread_cow::write", requests,
+             [&](std::size_t n) {
+               single_thread_cow<Config> c(base);
+               double seconds = bench::timed([&] {
+                 for (std::size_t i = 0; i < n; ++i)
+                   c.write().limits[i % 256] = int(i);
+               });
+               bench::doNotOptimize(c);
+               return seconds;
+             });
+
+  runner.run("unique_writes", "single_thread_cow::update", requests,
+             [&](std::size_t n) {
+               single_thread_cow<Config> c(base);
+               double seconds = bench::timed([&] {
+                 c.update([n](Config &v) {
+                   for (std::size_t i = 0; i < n; ++i)
+                     v.limits[i % 256] = int(i);
+                 });
+               });
+               bench::doNotOptimize(c);
+               return seconds;
+             });
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  bench::Runner runner{argc, argv};
+  runner.context("overlay_every", std::to_string(overlay_every));
+  suite(runner);
+  return runner.finish();
+}
@@ -0,0 +1,64 @@
+#include "bench.hpp"
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <vector>
+
+namespace {
+#ifdef SINGLE_THREAD_SHARED_PTR_DEFERRED_DELETE
+constexpr const char *mode = "deferred, drained when idle";
+#else
+constexpr const char *mode = "immediate";
+#endif
+
+struct Node {
+  explicit Node(int v) : value{v} {}
+  int value;
+  std::vector<single_thread_shared_ptr<Node>> children;
+};
+
+single_thread_shared_ptr<Node> buildTree(int depth, int fanout, int &next) {
+  auto node = make_single_thread_shared<Node>(next++);
+  if (depth > 0)
+    for (int i = 0; i < fanout; ++i)
+      node->children.push_back(buildTree(depth - 1, fanout, next));
+  return node;
+}
+
+// an event loop: every request replaces a cached graph, one in 32 of them
+// is big (4^8 + ... + 1 = 87381 nodes), between requests the loop is idle
+// and drains the queue in slices of 1024 objects
+constexpr std::size_t requests = 2048;
+constexpr std::size_t drain_budget = 1024;
+} // namespace
+
+int main(int argc, char **argv) {
+  bench::Runner runner{argc, argv};
+  runner.context("mode", mode);
+
+  std::vector<double> latencies;
+  std::vector<double> slices;
+  single_thread_shared_ptr<Node> cached;
+  for (std::size_t r = 0; r < requests; ++r) {
+    int next = 0;
+    auto graph = r % 32 == 0 ? buildTree(8, 4, next) : buildTree(2, 4, next);
+    latencies.push_back(bench::timed([&] {
+      cached = std::move(graph);
+      bench::doNotOptimize(cached);
+    }));
+    while (single_thread_shared_ptr_reclamation::size() != 0)
+      slices.push_back(bench::timed(
+          [] { single_thread_shared_ptr_reclamation::drain(drain_budget); }));
+  }
+
+  runner.add("request_p50", mode, requests, bench::percentile(latencies, 50));
+  runner.add("request_p99", mode, requests, bench::percentile(latencies, 99));
+  runner.add("request_p99.9", mode, requests,
+             bench::percentile(latencies, 99.9));
+  runner.add("request_max", mode, requests, bench::percentile(latencies, 100));
+  runner.add("drain_slice_p99", mode, slices.size(),
+             bench::percentile(slices, 99));
+  runner.add("drain_slice_max", mode, slices.size(),
+             bench::percentile(slices, 100));
+  return runner.finish();
+}
@@ -0,0 +1,122 @@
+#include "bench.hpp"
+
+#include <single_thread_shared_ptr/single_thread_local_shared_ptr.hpp>
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+struct Object {
+  explicit Object(int v) : value{v} {}
+  int value;
+};
+
+// copy and drop a pointer to one object shared by all threads, the copies
+// std::shared_ptr makes fight over the cache line of its atomic count
+constexpr std::size_t copies = 10'000'000;
+constexpr unsigned thread_counts[] = {1, 2, 4, 8};
+
+template <typename Ptr> long copyLoop(const Ptr &p, std::size_t n) {
+  long sum = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    Ptr copy = p;
+    bench::doNotOptimize(copy);
+    sum += copy->value;
+  }
+  return sum;
+}
+
+void scaling(bench::Runner &runner, unsigned threads) {
+  auto name = "shared_copy_" + std::to_string(threads) + "_threads";
+
+  // operations are per thread, so perfect scaling keeps ns/op constant
+  runner.run(name, "std::shared_ptr", copies, [&](std::size_t n) {
+    auto p = std::make_shared<Object>(1);
+    return bench::timed([&] {
+      std::vector<std::thread> workers;
+      for (unsigned t = 0; t < threads; ++t)
+        workers.emplace_back([&p, n] {
+          auto local = p;
+          bench::doNotOptimize(copyLoop(local, n));
+        });
+      for (auto &w : workers)
+        w.join();
+    });
+  });
+
+  runner.run(name, "single_thread_local_shared_ptr", copies,
+             [&](std::size_t n) {
+               auto p = make_single_thread_local_shared<Object>(1);
+               return bench::timed([&] {
+                 std::vector<std::thread> workers;
+                 for (unsigned t = 0; t < threads; ++t)
+                   workers.emplace_back([cross = p.to_thread(), n]() mutable {
+                     single_thread_local_shared_ptr<Object> local(
+                         std::move(cross));
+                     bench::doNotOptimize(copyLoop(local, n));
+                   });
+                 for (auto &w : workers)
+                   w.join();
+               });
+             });
+}
+
+// entering a thread: what a worker pays to start owning the object
+void handoff(bench::Runner &runner) {
+  runner.run("enter_thread", "std::shared_ptr", copies, [&](std::size_t n) {
+    auto p = std::make_shared<Object>(1);
+    return bench::timed([&] {
+      for (std::size_t i = 0; i < n; ++i) {
+        std::shared_ptr<Object> local = p;
+        bench::doNotOptimize(local);
+      }
+    });
+  });
+
+  runner.run("enter_thread", "single_thread_local_shared_ptr", copies,
+             [&](std::size_t n) {
+               auto p = make_single_thread_local_shared<Object>(1);
+               return bench::timed([&] {
+                 for (std::size_t i = 0; i < n; ++i) {
+                   single_thread_local_shared_ptr<Object> local(p.to_thread());
+                   bench::doNotOptimize(local);
+                 }
+               });
+             });
+}
+
+// copies on one thread against the plain single thread pointer
+void singleThread(bench::Runner &runner) {
+  runner.run("local_copy", "single_thread_shared_ptr", copies,
+             [&](std::size_t n) {
+               auto p = make_single_thread_shared<Object>(1);
+               return bench::timed(
+                   [&] { bench::doNotOptimize(copyLoop(p, n)); });
+             });
+
+  runner.run("local_copy", "single_thread_local_shared_ptr", copies,
+             [&](std::size_t n) {
+               auto p = make_single_thread_local_shared<Object>(1);
+               return bench::timed(
+                   [&] { bench::doNotOptimize(copyLoop(p, n)); });
+             });
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  bench::Runner runner{argc, argv};
+  // libstdc++ skips the atomic instructions until a second thread was
+  // started, which would flatter std::shared_ptr in the single thread cases
+  std::thread([] {}).join();
+  runner.context("hardware_concurrency",
+                 std::to_string(std::thread::hardware_concurrency()));
+
+  singleThread(runner);
+  handoff(runner);
+  for (unsigned threads : thread_counts)
+    scaling(runner, threads);
+  return runner.finish();
+}
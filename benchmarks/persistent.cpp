@@ -0,0 +1,189 @@
+#include "bench.hpp"
+
+#include <single_thread_shared_ptr/single_thread_persistent_map.hpp>
+#include <single_thread_shared_ptr/single_thread_persistent_vector.hpp>
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+// an undo history: every change keeps the previous version, the last
+// history versions are kept alive
+constexpr std::size_t elements = 100'000;
+constexpr std::size_t history = 16;
+constexpr std::size_t versions = 2'000;
+constexpr std::size_t batch = 64;
+
+// deterministic positions spread over the container
+std::size_t position(std::size_t i) noexcept {
+  return (i * 2654435761u) % elements;
+}
+
+template <typename Container, typename Change>
+double versioned(std::size_t n, const Container &initial, Change &&change) {
+  std::array<Container, history> kept;
+  Container current = initial;
+  double seconds = bench::timed([&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      kept[i % history] = current;
+      change(current, i);
+    }
+  });
+  bench::doNotOptimize(kept);
+  return seconds;
+}
+
+void vectors(bench::Runner &runner) {
+  std::vector<int> std_initial(elements);
+  single_thread_persistent_vector<int> initial;
+  for (std::size_t i = 0; i < elements; ++i) {
+    std_initial[i] = int(i);
+    initial.push_back(int(i));
+  }
+
+  runner.run("vector_version_set", "std::vector copy then set", versions,
+             [&](std::size_t n) {
+               return versioned(n, std_initial, [](auto &v, std::size_t i) {
+                 v[position(i)] = int(i);
+               });
+             });
+
+  runner.run("vector_version_set", "single_thread_persistent_vector",
+             versions, [&](std::size_t n) {
+               return versioned(n, initial, [](auto &v, std::size_t i) {
+                 v.set(position(i), int(i));
+               });
+             });
+
+  // one version per transaction of many changes
+  runner.run("vector_version_batch", "std::vector copy then set", versions,
+             [&](std::size_t n) {
+               return versioned(n, std_initial, [](auto &v, std::size_t i) {
+                 for (std::size_t j = 0; j < batch; ++j)
+                   v[position(i * batch + j)] = int(j);
+               });
+             });
+
+  runner.run("vector_version_batch", "single_thread_persistent_vector",
+             versions, [&](std::size_t n) {
+               return versioned(n, initial, [](auto &v, std::size_t i) {
+                 for (std::size_t j = 0; j < batch; ++j)
+                   v.set(position(i * batch + j), int(j));
+               });
+             });
+
+  runner.run("vector_push_back", "std::vector", elements, [&](std::size_t n) {
+    std::vector<int> v;
+    double seconds = bench::timed([&] {
+      for (std::size_t i = 0; i < n; ++i)
+        v.push_back(int(i));
+    });
+    bench::doNotOptimize(v);
+    return seconds;
+  });
+
+  runner.run("vector_push_back", "single_thread_persistent_vector", elements,
+             [&](std::size_t n) {
+               single_thread_persistent_vector<int> v;
+               double seconds = bench::timed([&] {
+                 for (std::size_t i = 0; i < n; ++i)
+                   v.push_back(int(i));
+               });
+               bench::doNotOptimize(v);
+               return seconds;
+             });
+
+  runner.run("vector_read", "std::vector", elements, [&](std::size_t n) {
+    long sum = 0;
+    double seconds = bench::timed([&] {
+      for (std::size_t i = 0; i < n; ++i)
+        sum += std_initial[position(i)];
+    });
+    bench::doNotOptimize(sum);
+    return seconds;
+  });
+
+  runner.run("vector_read", "single_thread_persistent_vector", elements,
+             [&](std::size_t n) {
+               long sum = 0;
+               double seconds = bench::timed([&] {
+                 for (std::size_t i = 0; i < n; ++i)
+                   sum += initial[position(i)];
+               });
+               bench::doNotOptimize(sum);
+               return seconds;
+             });
+}
+
+void maps(bench::Runner &runner) {
+  std::unordered_map<int, int> std_initial;
+  single_thread_persistent_map<int, int> initial;
+  for (std::size_t i = 0; i < elements; ++i) {
+    std_initial[int(i)] = int(i);
+    initial.insert_or_assign(int(i), int(i));
+  }
+
+  runner.run("map_version_assign", "std::unordered_map copy then assign",
+             versions / 10, [&](std::size_t n) {
+               return versioned(n, std_initial, [](auto &m, std::size_t i) {
+                 m[int(position(i))] = int(i);
+               });
+             });
+
+  runner.run("map_version_assign", "single_thread_persistent_map", versions,
+             [&](std::size_t n) {
+               return versioned(n, initial, [](auto &m, std::size_t i) {
+                 m.insert_or_assign(int(position(i)), int(i));
+               });
+             });
+
+  runner.run("map_version_batch", "std::unordered_map copy then assign",
+             versions / 10, [&](std::size_t n) {
+               return versioned(n, std_initial, [](auto &m, std::size_t i) {
+                 for (std::size_t j = 0; j < batch; ++j)
+                   m[int(position(i * batch + j))] = int(j);
+               });
+             });
+
+  runner.run("map_version_batch", "single_thread_persistent_map", versions,
+             [&](std::size_t n) {
+               return versioned(n, initial, [](auto &m, std::size_t i) {
+                 for (std::size_t j = 0; j < batch; ++j)
+                   m.insert_or_assign(int(position(i * batch + j)), int(j));
+               });
+             });
+
+  runner.run("map_find", "std::unordered_map", elements, [&](std::size_t n) {
+    long sum = 0;
+    double seconds = bench::timed([&] {
+      for (std::size_t i = 0; i < n; ++i)
+        sum += std_initial.find(int(position(i)))->second;
+    });
+    bench::doNotOptimize(sum);
+    return seconds;
+  });
+
+  runner.run("map_find", "single_thread_persistent_map", elements,
+             [&](std::size_t n) {
+               long sum = 0;
+               double seconds = bench::timed([&] {
+                 for (std::size_t i = 0; i < n; ++i)
+                   sum += initial.at(int(position(i)));
+               });
+               bench::doNotOptimize(sum);
+               return seconds;
+             });
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  bench::Runner runner{argc, argv};
+  runner.context("elements", std::to_string(elements));
+  runner.context("history", std::to_string(history));
+  runner.context("batch", std::to_string(batch));
+  vectors(runner);
+  maps(runner);
+  return runner.finish();
+}
@@ -0,0 +1,60 @@
+#include "bench.hpp"
+
+#include <single_thread_shared_ptr/single_thread_relocating_vector.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+struct Object {
+  explicit Object(int v) : value{v} {}
+  int value;
+};
+
+using ptr = single_thread_shared_ptr<Object>;
+
+// growth and erase touch every element, the objects themselves are shared
+// so creating them stays out of the measurement
+constexpr std::size_t elements = 2'000'000;
+constexpr std::size_t erases = 100;
+
+template <typename Vector>
+void suite(bench::Runner &runner, const std::string &name,
+           const std::vector<ptr> &objects) {
+  runner.run("push_back", name, elements, [&](std::size_t n) {
+    Vector v;
+    auto ns = bench::timed([&] {
+      for (std::size_t i = 0; i < n; ++i)
+        v.push_back(objects[i % objects.size()]);
+      bench::doNotOptimize(v);
+    });
+    return ns;
+  });
+
+  // erase near the front, the whole tail is shifted every time
+  runner.run("erase", name, erases, [&](std::size_t n) {
+    Vector v;
+    v.reserve(elements);
+    for (std::size_t i = 0; i < elements; ++i)
+      v.push_back(objects[i % objects.size()]);
+    return bench::timed([&] {
+      for (std::size_t i = 0; i < n && !v.empty(); ++i)
+        v.erase(v.begin() + static_cast<std::ptrdiff_t>(i % 16));
+      bench::doNotOptimize(v);
+    });
+  });
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  bench::Runner runner{argc, argv};
+
+  std::vector<ptr> objects;
+  for (int i = 0; i < 1024; ++i)
+    objects.push_back(make_single_thread_shared<Object>(i));
+
+  suite<std::vector<ptr>>(runner, "std::vector", objects);
+  suite<single_thread_shared_vector<Object>>(
+      runner, "single_thread_shared_vector", objects);
+  return runner.finish();
+}
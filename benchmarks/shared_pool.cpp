@@ -0,0 +1,81 @@
+#include "bench.hpp"
+
+#include <single_thread_shared_ptr/single_thread_shared_pool.hpp>
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <array>
+#include <memory>
+#include <string>
+
+namespace {
+struct Message {
+  Message() = default;
+  explicit Message(int v) : id{v} {}
+  int id{0};
+  std::string payload;
+};
+
+// messages are created, filled and released a window later, as a queue of
+// in flight messages would
+constexpr std::size_t messages = 2'000'000;
+constexpr std::size_t window = 64;
+const std::string text(100, 'm');
+
+template <typename Ptr, typename Make> double churn(std::size_t n, Make &&make) {
+  std::array<Ptr, window> in_flight;
+  return bench::timed([&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      Ptr p = make(int(i));
+      p->payload.assign(text);
+      in_flight[i % window] = std::move(p);
+    }
+    for (auto &p : in_flight)
+      p.reset();
+  });
+}
+
+void suite(bench::Runner &runner) {
+  using ptr = single_thread_shared_ptr<Message>;
+
+  runner.run("message_churn", "new / delete", messages, [&](std::size_t n) {
+    return churn<ptr>(n, [](int v) { return ptr(new Message(v)); });
+  });
+
+  runner.run("message_churn", "make_single_thread_shared", messages,
+             [&](std::size_t n) {
+               return churn<ptr>(
+                   n, [](int v) { return make_single_thread_shared<Message>(v); });
+             });
+
+  runner.run("message_churn", "std::make_shared", messages, [&](std::size_t n) {
+    return churn<std::shared_ptr<Message>>(
+        n, [](int v) { return std::make_shared<Message>(v); });
+  });
+
+  runner.run("message_churn", "single_thread_shared_pool::make", messages,
+             [&](std::size_t n) {
+               single_thread_shared_pool<Message> pool(window);
+               return churn<ptr>(n, [&pool](int v) { return pool.make(v); });
+             });
+
+  // released messages keep their payload buffer
+  runner.run("message_churn", "single_thread_shared_pool::acquire", messages,
+             [&](std::size_t n) {
+               single_thread_shared_pool<Message> pool(
+                   window, [](Message &m) { m.payload.clear(); });
+               return churn<ptr>(n, [&pool](int v) {
+                 auto p = pool.acquire();
+                 p->id = v;
+                 return p;
+               });
+             });
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  bench::Runner runner{argc, argv};
+  runner.context("window", std::to_string(window));
+  runner.context("payload_bytes", std::to_string(text.size()));
+  suite(runner);
+  return runner.finish();
+}
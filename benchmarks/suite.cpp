@@ -0,0 +1,251 @@
+#include "bench.hpp"
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+struct Object {
+  explicit Object(int v) : value{v} {}
+  int value;
+};
+
+// Every implementation is driven through the same small interface, raw
+// pointers release their objects explicitly in drop().
+struct SingleThread {
+  static constexpr const char *name = "single_thread_shared_ptr";
+  template <typename T> using ptr = single_thread_shared_ptr<T>;
+  template <typename T, typename... Args> static ptr<T> make(Args &&...args) {
+    return ptr<T>(new T(std::forward<Args>(args)...));
+  }
+  template <typename T> static void drop(ptr<T> &) {}
+};
+
+struct SingleThreadMake : SingleThread {
+  static constexpr const char *name = "make_single_thread_shared";
+  template <typename T, typename... Args> static ptr<T> make(Args &&...args) {
+    return make_single_thread_shared<T>(std::forward<Args>(args)...);
+  }
+};
+
+struct Std {
+  static constexpr const char *name = "std::shared_ptr";
+  template <typename T> using ptr = std::shared_ptr<T>;
+  template <typename T, typename... Args> static ptr<T> make(Args &&...args) {
+    return ptr<T>(new T(std::forward<Args>(args)...));
+  }
+  template <typename T> static void drop(ptr<T> &) {}
+};
+
+struct StdMake : Std {
+  static constexpr const char *name = "std::make_shared";
+  template <typename T, typename... Args> static ptr<T> make(Args &&...args) {
+    return std::make_shared<T>(std::forward<Args>(args)...);
+  }
+};
+
+struct Raw {
+  static constexpr const char *name = "raw pointer";
+  template <typename T> using ptr = T *;
+  template <typename T, typename... Args> static ptr<T> make(Args &&...args) {
+    return new T(std::forward<Args>(args)...);
+  }
+  template <typename T> static void drop(ptr<T> &p) { delete p; }
+};
+
+template <typename P> struct Node {
+  using ptr = typename P::template ptr<Node>;
+  explicit Node(int v) : value{v} {}
+  ~Node() {
+    for (auto &c : children)
+      P::drop(c);
+  }
+  int value;
+  std::vector<ptr> children;
+};
+
+template <typename P>
+typename Node<P>::ptr buildTree(int depth, int fanout, int &next) {
+  auto node = P::template make<Node<P>>(next++);
+  if (depth > 0)
+    for (int i = 0; i < fanout; ++i)
+      node->children.push_back(buildTree<P>(depth - 1, fanout, next));
+  return node;
+}
+
+constexpr std::size_t ops = 2'000'000;
+constexpr std::size_t elements = 100'000;
+
+template <typename P> void suite(bench::Runner &runner) {
+  using ptr = typename P::template ptr<Object>;
+
+  runner.run("create_destroy", P::name, ops, [](std::size_t n) {
+    return bench::timed([&] {
+      for (std::size_t i = 0; i < n; ++i) {
+        ptr p = P::template make<Object>(int(i));
+        bench::doNotOptimize(p);
+        P::drop(p);
+      }
+    });
+  });
+
+  // first copy of a sole owner, the object is created every time
+  runner.run("create_copy_destroy", P::name, ops, [](std::size_t n) {
+    return bench::timed([&] {
+      for (std::size_t i = 0; i < n; ++i) {
+        ptr p = P::template make<Object>(int(i));
+        ptr c = p;
+        bench::doNotOptimize(c);
+        P::drop(p);
+      }
+    });
+  });
+
+  runner.run("copy", P::name, ops * 10, [](std::size_t n) {
+    ptr p = P::template make<Object>(1);
+    ptr keep = p;
+    auto ns = bench::timed([&] {
+      for (std::size_t i = 0; i < n; ++i) {
+        ptr c = p;
+        bench::doNotOptimize(c);
+      }
+    });
+    bench::doNotOptimize(keep);
+    P::drop(p);
+    return ns;
+  });
+
+  runner.run("move", P::name, ops * 10, [](std::size_t n) {
+    ptr p = P::template make<Object>(1);
+    auto ns = bench::timed([&] {
+      for (std::size_t i = 0; i < n; ++i) {
+        ptr m = std::move(p);
+        bench::doNotOptimize(m);
+        p = std::move(m);
+      }
+    });
+    P::drop(p);
+    return ns;
+  });
+
+  runner.run("assign", P::name, ops * 10, [](std::size_t n) {
+    ptr a = P::template make<Object>(1);
+    ptr b = P::template make<Object>(2);
+    ptr target = a;
+    auto ns = bench::timed([&] {
+      for (std::size_t i = 0; i < n; ++i) {
+        target = (i & 1) ? a : b;
+        bench::doNotOptimize(target);
+      }
+    });
+    P::drop(a);
+    P::drop(b);
+    return ns;
+  });
+
+  runner.run("reset_copy", P::name, ops * 10, [](std::size_t n) {
+    ptr p = P::template make<Object>(1);
+    ptr keep = p;
+    auto ns = bench::timed([&] {
+      for (std::size_t i = 0; i < n; ++i) {
+        ptr c = p;
+        bench::doNotOptimize(c);
+        c = ptr{};
+        bench::doNotOptimize(c);
+      }
+    });
+    bench::doNotOptimize(keep);
+    P::drop(p);
+    return ns;
+  });
+
+  runner.run("destroy", P::name, elements, [](std::size_t n) {
+    std::vector<ptr> v;
+    v.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+      v.push_back(P::template make<Object>(int(i)));
+    return bench::timed([&] {
+      for (auto &p : v)
+        P::drop(p);
+      v.clear();
+    });
+  });
+
+  runner.run("container_fill", P::name, elements, [](std::size_t n) {
+    std::vector<ptr> v;
+    auto ns = bench::timed([&] {
+      for (std::size_t i = 0; i < n; ++i)
+        v.push_back(P::template make<Object>(int(i)));
+      bench::doNotOptimize(v);
+    });
+    for (auto &p : v)
+      P::drop(p);
+    return ns;
+  });
+
+  runner.run("container_copy", P::name, elements, [](std::size_t n) {
+    std::vector<ptr> v;
+    for (std::size_t i = 0; i < n; ++i)
+      v.push_back(P::template make<Object>(int(i)));
+    auto ns = bench::timed([&] {
+      std::vector<ptr> copy = v;
+      bench::doNotOptimize(copy);
+    });
+    for (auto &p : v)
+      P::drop(p);
+    return ns;
+  });
+
+  runner.run("container_sort", P::name, elements, [](std::size_t n) {
+    std::vector<ptr> v;
+    std::mt19937 random{42};
+    for (std::size_t i = 0; i < n; ++i)
+      v.push_back(P::template make<Object>(int(random())));
+    auto ns = bench::timed([&] {
+      std::sort(v.begin(), v.end(),
+                [](const ptr &a, const ptr &b) { return a->value < b->value; });
+    });
+    for (auto &p : v)
+      P::drop(p);
+    return ns;
+  });
+
+  // 4^8 + ... + 1 = 87381 nodes
+  runner.run("graph_teardown", P::name, 87381, [](std::size_t n) {
+    double ns = 0;
+    for (std::size_t done = 0; done < n; done += 87381) {
+      int next = 0;
+      auto root = buildTree<P>(8, 4, next);
+      ns += bench::timed([&] { P::drop(root), root = {}; });
+    }
+    return ns;
+  });
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  bench::Runner runner{argc, argv};
+#if defined(__VERSION__)
+  runner.context("compiler", __VERSION__);
+#endif
+#if defined(NDEBUG)
+  runner.context("assertions", "off");
+#else
+  runner.context("assertions", "on");
+#endif
+#if defined(SINGLE_THREAD_SHARED_PTR_COUNTER_POOL)
+  runner.context("counter_allocator", "pool");
+#else
+  runner.context("counter_allocator", "heap");
+#endif
+
+  suite<SingleThread>(runner);
+  suite<SingleThreadMake>(runner);
+  suite<Std>(runner);
+  suite<StdMake>(runner);
+  suite<Raw>(runner);
+  return runner.finish();
+}
@@ -0,0 +1,164 @@
+// Compares the assembly of snippets.cpp with the expectations written
+// above each function, see snippets.cpp. Understands the AT&T x86-64 and
+// the AArch64 syntax of GCC and Clang.
+//   check_codegen SNIPPETS ASSEMBLY LABEL
+// Exits with 1 when a function makes more calls or branches than expected
+// or is missing from the assembly.
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+struct Counts {
+  int new_calls{0};
+  int delete_calls{0};
+  int other_calls{0};
+  int branches{0};
+};
+
+const char *keys[] = {"new", "delete", "calls", "branches"};
+
+int &get(Counts &c, const std::string &key) {
+  if (key == "new")
+    return c.new_calls;
+  if (key == "delete")
+    return c.delete_calls;
+  if (key == "calls")
+    return c.other_calls;
+  return c.branches;
+}
+
+bool startsWith(const std::string &s, const std::string &prefix) {
+  return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// expectations by function, -1 for keys which are not checked
+std::map<std::string, Counts> readExpectations(const char *path) {
+  std::map<std::string, Counts> expected;
+  std::ifstream in(path);
+  std::string line;
+  bool pending = false;
+  Counts current;
+  while (std::getline(in, line)) {
+    if (startsWith(line, "// expect:")) {
+      current = Counts{-1, -1, -1, -1};
+      std::istringstream fields(line.substr(10));
+      std::string field;
+      while (fields >> field) {
+        auto eq = field.find('=');
+        get(current, field.substr(0, eq)) = std::stoi(field.substr(eq + 1));
+      }
+      pending = true;
+      continue;
+    }
+    auto at = line.find("codegen_");
+    if (pending && at != std::string::npos) {
+      auto end = line.find('(', at);
+      expected[line.substr(at, end - at)] = current;
+      pending = false;
+    }
+  }
+  return expected;
+}
+
+// local labels of GCC (.L) and Clang (.L on ELF, L on Mach-O)
+bool isLocalLabel(const std::string &target) {
+  return startsWith(target, ".L") || startsWith(target, "L");
+}
+
+void classify(const std::string &mnemonic, const std::string &operand,
+              Counts &c) {
+  bool call = mnemonic == "bl" || mnemonic == "blr" ||
+              startsWith(mnemonic, "call");
+  bool tail = (mnemonic == "jmp" || mnemonic == "b" || mnemonic == "br") &&
+              !isLocalLabel(operand);
+  if (call || tail) {
+    if (operand.find("_Znw") != std::string::npos ||
+        operand.find("_Zna") != std::string::npos)
+      ++c.new_calls;
+    else if (operand.find("_Zdl") != std::string::npos ||
+             operand.find("_Zda") != std::string::npos)
+      ++c.delete_calls;
+    else
+      ++c.other_calls;
+    return;
+  }
+  if ((mnemonic[0] == 'j' && mnemonic != "jmp") || startsWith(mnemonic, "b.") ||
+      mnemonic == "cbz" || mnemonic == "cbnz" || mnemonic == "tbz" ||
+      mnemonic == "tbnz")
+    ++c.branches;
+}
+
+std::map<std::string, Counts> readAssembly(const char *path) {
+  std::map<std::string, Counts> found;
+  std::ifstream in(path);
+  std::string line;
+  Counts *current = nullptr;
+  while (std::getline(in, line)) {
+    auto comment = line.find_first_of("#;");
+    if (comment != std::string::npos && !startsWith(line, "#"))
+      line.erase(comment);
+    if (line.empty())
+      continue;
+    if (line[0] != ' ' && line[0] != '\t') {
+      auto label = line.substr(0, line.find(':'));
+      if (startsWith(label, "_codegen_"))
+        label.erase(0, 1);
+      if (startsWith(label, "codegen_") && line.find(':') != std::string::npos)
+        current = &found[label];
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string mnemonic, operand;
+    fields >> mnemonic >> operand;
+    if (mnemonic == ".cfi_endproc")
+      current = nullptr;
+    if (current && !mnemonic.empty() && mnemonic[0] != '.')
+      classify(mnemonic, operand, *current);
+  }
+  return found;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 4) {
+    std::fprintf(stderr, "usage: %s SNIPPETS ASSEMBLY LABEL\n", argv[0]);
+    return 2;
+  }
+  auto expected = readExpectations(argv[1]);
+  auto found = readAssembly(argv[2]);
+  if (expected.empty()) {
+    std::fprintf(stderr, "%s: no expectations found\n", argv[1]);
+    return 2;
+  }
+
+  bool ok = true;
+  for (auto &[name, limits] : expected) {
+    auto it = found.find(name);
+    if (it == found.end()) {
+      std::printf("%-10s %-32s missing from the assembly\n", argv[3],
+                  name.c_str());
+      ok = false;
+      continue;
+    }
+    std::string failures;
+    for (const char *key : keys) {
+      int limit = get(limits, key);
+      int actual = get(it->second, key);
+      if (limit >= 0 && actual > limit)
+        failures += std::string(" ") + key + "=" + std::to_string(actual) +
+                    " (expected at most " + std::to_string(limit) + ")";
+    }
+    std::printf("%-10s %-32s new=%d delete=%d calls=%d branches=%d%s\n",
+                argv[3], name.c_str(), it->second.new_calls,
+                it->second.delete_calls, it->second.other_calls,
+                it->second.branches,
+                failures.empty() ? "" : ("  FAILED:" + failures).c_str());
+    ok = ok && failures.empty();
+  }
+  return ok ? 0 : 1;
+}
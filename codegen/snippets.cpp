@@ -0,0 +1,105 @@
+// Representative uses of single_thread_shared_ptr whose optimized code is
+// checked by check_codegen. Every function is preceded by the most calls
+// of operator new and delete, other calls (tail calls included) and
+// conditional branches it may compile to at -O2 -DNDEBUG, a missing key is
+// not checked. The functions are extern "C" so their labels are easy to
+// find in the assembly.
+
+#include <single_thread_shared_ptr/single_thread_cow.hpp>
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <new>
+#include <utility>
+
+using ptr = single_thread_shared_ptr<int>;
+
+struct Settings {
+  int values[16];
+};
+
+extern "C" {
+
+// a sole owner keeps its count inline, so the pair of new and delete is
+// removed altogether
+// expect: new=0 delete=0 calls=0 branches=0
+int codegen_create_and_drop(int v) {
+  ptr p(new int(v));
+  return *p;
+}
+
+// one allocation for the object and its count, released out of line
+// expect: new=1 delete=0 calls=1 branches=0
+int codegen_make_and_drop(int v) {
+  auto p = make_single_thread_shared<int>(v);
+  return *p;
+}
+
+// moved from pointers are known to be empty and release nothing
+// expect: new=0 delete=0 calls=0 branches=0
+void codegen_move_chain(ptr *out, ptr *in) {
+  ptr a(std::move(*in));
+  ptr b(std::move(a));
+  ptr c = std::move(b);
+  ::new (static_cast<void *>(out)) ptr(std::move(c));
+}
+
+// expect: new=1 delete=1 calls=0 branches=0
+int codegen_move_round_trip(int v) {
+  ptr p(new int(v));
+  ptr a = std::move(p);
+  p = std::move(a);
+  return *p;
+}
+
+// copies of a pointer created with its count never promote it, the block
+// releases itself out of line like after make_and_drop
+// expect: new=1 delete=0 calls=1 branches=0
+int codegen_make_local_copies(int v) {
+  auto p = make_single_thread_shared<int>(v);
+  ptr c = p;
+  ptr d = c;
+  return *d;
+}
+
+// the copies promote the count to a cell, whose counts are known all the
+// way down: the object's new and delete are removed, the cell's remain
+// expect: new=1 delete=1 calls=0 branches=0
+int codegen_local_copies(int v) {
+  ptr p(new int(v));
+  ptr c = p;
+  ptr d = c;
+  return *d;
+}
+
+// expect: new=1 delete=0 calls=1 branches=0
+void codegen_make_and_reset() {
+  auto p = make_single_thread_shared<int>(1);
+  p.reset();
+}
+
+// expect: new=0 delete=0 calls=0 branches=0
+void codegen_reset_moved_from(ptr *out, ptr *in) {
+  ::new (static_cast<void *>(out)) ptr(std::move(*in));
+  in->reset();
+}
+
+// expect: new=0 delete=0 calls=0 branches=0
+void codegen_reset_empty() {
+  ptr p;
+  p.reset();
+}
+
+// expect: new=0 delete=0 calls=0 branches=0
+void codegen_swap(ptr &a, ptr &b) { a.swap(b); }
+
+// writes check once that nothing else sees the object: an object nobody
+// shares keeps its count inline and takes the first branch, the other two
+// test a heap count, the copy is made out of line
+// expect: new=0 delete=0 calls=1 branches=3
+void codegen_cow_update(single_thread_cow<Settings> &c) {
+  c.update([](Settings &s) {
+    s.values[0] = 1;
+    s.values[15] = 2;
+  });
+}
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Reference count in front of an object created by
+// make_single_thread_compact. The object follows at the first suitably
+// aligned offset, so its address is enough to find the count.
+template <typename _Tp> struct single_thread_compact_block {
+  static_assert(!std::is_array_v<_Tp>, "arrays are not supported");
+  using object_type = std::remove_cv_t<_Tp>;
+
+  static constexpr std::size_t offset() noexcept {
+    return (sizeof(single_thread_compact_block) + alignof(object_type) - 1) /
+           alignof(object_type) * alignof(object_type);
+  }
+  static constexpr std::size_t alignment =
+      alignof(object_type) > alignof(unsigned) ? alignof(object_type)
+                                               : alignof(unsigned);
+
+  static single_thread_compact_block *of(const volatile void *object) noexcept {
+    return reinterpret_cast<single_thread_compact_block *>(
+        reinterpret_cast<char *>(const_cast<void *>(object)) - offset());
+  }
+
+  template <typename... _Args> static object_type *create(_Args &&...__args) {
+    void *mem = allocate();
+    auto *block = ::new (mem) single_thread_compact_block{1};
+    try {
+      return ::new (static_cast<void *>(static_cast<char *>(mem) + offset()))
+          object_type(std::forward<_Args>(__args)...);
+    } catch (...) {
+      deallocate(block);
+      throw;
+    }
+  }
+
+  static void destroy(const volatile void *object) noexcept {
+    static_cast<const volatile object_type *>(object)->~object_type();
+    deallocate(of(object));
+  }
+
+  unsigned _count;
+
+private:
+  static void *allocate() {
+    if constexpr (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+      return ::operator new(offset() + sizeof(object_type),
+                            std::align_val_t{alignment});
+    else
+      return ::operator new(offset() + sizeof(object_type));
+  }
+
+  static void deallocate(single_thread_compact_block *block) noexcept {
+    if constexpr (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+      ::operator delete(static_cast<void *>(block),
+                        std::align_val_t{alignment});
+    else
+      ::operator delete(static_cast<void *>(block));
+  }
+};
+
+/// One word, NON THREAD SAFE shared pointer to an object created by
+/// make_single_thread_compact. The count lives in front of the object in the
+/// same allocation, so unlike single_thread_shared_ptr it cannot adopt raw
+/// pointers, take deleters or convert to base classes (only to const T).
+template <typename T> class single_thread_compact_ptr {
+private:
+  using block = single_thread_compact_block<std::remove_cv_t<T>>;
+
+  template <typename _Yp>
+  using _Compatible = typename std::enable_if<
+      std::is_same_v<std::remove_cv_t<_Yp>, std::remove_cv_t<T>> &&
+      std::is_convertible<_Yp *, T *>::value>::type;
+
+public:
+  using element_type = T;
+  using trivially_relocatable = std::true_type;
+
+  constexpr single_thread_compact_ptr() noexcept : _M_ptr{nullptr} {}
+
+  constexpr single_thread_compact_ptr(std::nullptr_t) noexcept
+      : _M_ptr{nullptr} {}
+
+  single_thread_compact_ptr(const single_thread_compact_ptr &rhs) noexcept
+      : _M_ptr{acquire(rhs._M_ptr)} {}
+
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  single_thread_compact_ptr(const single_thread_compact_ptr<_Yp> &rhs) noexcept
+      : _M_ptr{acquire(rhs._M_ptr)} {}
+
+  single_thread_compact_ptr(single_thread_compact_ptr &&rhs) noexcept
+      : _M_ptr{std::exchange(rhs._M_ptr, nullptr)} {}
+
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  single_thread_compact_ptr(single_thread_compact_ptr<_Yp> &&rhs) noexcept
+      : _M_ptr{std::exchange(rhs._M_ptr, nullptr)} {}
+
+  single_thread_compact_ptr &
+  operator=(const single_thread_compact_ptr &rhs) noexcept {
+    single_thread_compact_ptr(rhs).swap(*this);
+    return *this;
+  }
+
+  single_thread_compact_ptr &operator=(single_thread_compact_ptr &&rhs) noexcept {
+    single_thread_compact_ptr(std::move(rhs)).swap(*this);
+    return *this;
+  }
+
+  ~single_thread_compact_ptr() noexcept {
+    if (_M_ptr && --block::of(_M_ptr)->_count == 0)
+      block::destroy(_M_ptr);
+  }
+
+  T &operator*() const noexcept {
+    assert(_M_ptr != nullptr);
+    return *_M_ptr;
+  }
+
+  T *operator->() const noexcept { return _M_ptr; }
+
+  T *get() const noexcept { return _M_ptr; }
+
+  long use_count() const noexcept {
+    return _M_ptr ? block::of(_M_ptr)->_count : 0;
+  }
+
+  void reset() noexcept { single_thread_compact_ptr{}.swap(*this); }
+
+  void swap(single_thread_compact_ptr &rhs) noexcept {
+    std::swap(_M_ptr, rhs._M_ptr);
+  }
+
+  explicit operator bool() const noexcept { return _M_ptr == 0 ? false : true; }
+
+  template <typename _Yp> friend class single_thread_compact_ptr;
+
+  template <typename _Tp, typename... _Args>
+  friend single_thread_compact_ptr<_Tp>
+  make_single_thread_compact(_Args &&...__args);
+
+private:
+  // adopts the first reference of a new block
+  explicit single_thread_compact_ptr(T *ptr) noexcept : _M_ptr{ptr} {}
+
+  static T *acquire(T *ptr) noexcept {
+    if (ptr)
+      ++block::of(ptr)->_count;
+    return ptr;
+  }
+
+  T *_M_ptr;
+};
+
+/// Create an object behind its reference count and the first pointer to it
+template <typename _Tp, typename... _Args>
+inline single_thread_compact_ptr<_Tp>
+make_single_thread_compact(_Args &&...__args) {
+  return single_thread_compact_ptr<_Tp>(
+      single_thread_compact_block<std::remove_cv_t<_Tp>>::create(
+          std::forward<_Args>(__args)...));
+}
+
+/// Equality operator for compact_ptr objects, compares the stored pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator==(const single_thread_compact_ptr<_Tp> &__a,
+           const single_thread_compact_ptr<_Up> &__b) noexcept {
+  return __a.get() == __b.get();
+}
+
+/// compact_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool operator==(const single_thread_compact_ptr<_Tp> &__a,
+                                     std::nullptr_t) noexcept {
+  return !__a;
+}
+
+/// compact_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator==(std::nullptr_t, const single_thread_compact_ptr<_Tp> &__a) noexcept {
+  return !__a;
+}
+
+/// Inequality operator for compact_ptr objects, compares the stored pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator!=(const single_thread_compact_ptr<_Tp> &__a,
+           const single_thread_compact_ptr<_Up> &__b) noexcept {
+  return __a.get() != __b.get();
+}
+
+/// compact_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool operator!=(const single_thread_compact_ptr<_Tp> &__a,
+                                     std::nullptr_t) noexcept {
+  return (bool)__a;
+}
+
+/// compact_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator!=(std::nullptr_t, const single_thread_compact_ptr<_Tp> &__a) noexcept {
+  return (bool)__a;
+}
+
+/// Relational operator for compact_ptr objects, compares the stored pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator<(const single_thread_compact_ptr<_Tp> &__a,
+          const single_thread_compact_ptr<_Up> &__b) noexcept {
+  using _Vp = std::common_type_t<_Tp *, _Up *>;
+  return std::less<_Vp>()(__a.get(), __b.get());
+}
+
+/// Relational operator for compact_ptr objects, compares the stored pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator<=(const single_thread_compact_ptr<_Tp> &__a,
+           const single_thread_compact_ptr<_Up> &__b) noexcept {
+  return !(__b < __a);
+}
+
+/// Relational operator for compact_ptr objects, compares the stored pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator>(const single_thread_compact_ptr<_Tp> &__a,
+          const single_thread_compact_ptr<_Up> &__b) noexcept {
+  return (__b < __a);
+}
+
+/// Relational operator for compact_ptr objects, compares the stored pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator>=(const single_thread_compact_ptr<_Tp> &__a,
+           const single_thread_compact_ptr<_Up> &__b) noexcept {
+  return !(__a < __b);
+}
+
+namespace std {
+template <typename _Tp> struct hash<single_thread_compact_ptr<_Tp>> {
+  size_t operator()(const single_thread_compact_ptr<_Tp> &s) const noexcept {
+    return std::hash<_Tp *>()(s.get());
+  }
+};
+} // namespace std
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <cassert>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+/// NON THREAD SAFE copy on write value. Copies share one object, reads never
+/// copy it, and the first write through a wrapper that shares its object
+/// (with another wrapper, a snapshot() or a weak pointer to one) gives it a
+/// copy of its own. The object keeps its count inline while it is not
+/// shared, so a write checking that nothing else sees it is one compare.
+/// update(f) runs many writes after a single check.
+/// A moved from wrapper may only be assigned to or destroyed.
+template <typename T> class single_thread_cow {
+  static_assert(!std::is_array_v<T>, "arrays are not supported");
+  static_assert(!std::is_const_v<T>, "the value has to be writable");
+
+public:
+  using element_type = T;
+
+  single_thread_cow() : single_thread_cow(std::in_place) {}
+
+  template <typename... _Args>
+  explicit single_thread_cow(std::in_place_t, _Args &&...__args)
+      : _M_ptr(new T(std::forward<_Args>(__args)...)) {}
+
+  single_thread_cow(const T &value) : single_thread_cow(std::in_place, value) {}
+
+  single_thread_cow(T &&value)
+      : single_thread_cow(std::in_place, std::move(value)) {}
+
+  /// Wraps an existing object, written in place while p is its only owner
+  explicit single_thread_cow(single_thread_shared_ptr<T> p) noexcept
+      : _M_ptr(std::move(p)) {
+    assert(_M_ptr);
+  }
+
+  single_thread_cow(const single_thread_cow &) = default;
+  single_thread_cow(single_thread_cow &&) noexcept = default;
+  single_thread_cow &operator=(const single_thread_cow &) = default;
+  single_thread_cow &operator=(single_thread_cow &&) noexcept = default;
+
+  /// Replaces the value, in place when the object is not shared
+  single_thread_cow &operator=(const T &value) {
+    assign(value);
+    return *this;
+  }
+
+  single_thread_cow &operator=(T &&value) {
+    assign(std::move(value));
+    return *this;
+  }
+
+  const T &operator*() const noexcept { return *_M_ptr; }
+  const T *operator->() const noexcept { return _M_ptr.get(); }
+  const T &read() const noexcept { return *_M_ptr; }
+
+  /// The object for writing, copied first when it is shared. The reference
+  /// must not be written through once the wrapper was copied (or a
+  /// snapshot() taken), the copy would see the writes; prefer update().
+  T &write() {
+    if (!single_thread_shared_ptr_factory::isUnique(_M_ptr))
+      detach();
+    return *_M_ptr;
+  }
+
+  /// f(T &) with the object for writing, returns what f returns
+  template <typename _Fn> decltype(auto) update(_Fn &&f) {
+    return std::invoke(std::forward<_Fn>(f), write());
+  }
+
+  /// Read only owner of the current value, later writes do not change it
+  single_thread_shared_ptr<const T> snapshot() const noexcept {
+    return _M_ptr;
+  }
+
+  /// True when a write does not copy the object
+  bool unique() const noexcept {
+    return single_thread_shared_ptr_factory::isUnique(_M_ptr);
+  }
+
+  long use_count() const noexcept { return _M_ptr.use_count(); }
+
+  void swap(single_thread_cow &rhs) noexcept { _M_ptr.swap(rhs._M_ptr); }
+
+private:
+  // only the first write after sharing pays for the copy
+  SINGLE_THREAD_SHARED_PTR_NOINLINE void detach() {
+    _M_ptr = single_thread_shared_ptr<T>(new T(std::as_const(*_M_ptr)));
+  }
+
+  template <typename _Up> void assign(_Up &&value) {
+    if (single_thread_shared_ptr_factory::isUnique(_M_ptr))
+      *_M_ptr = std::forward<_Up>(value);
+    else
+      _M_ptr = single_thread_shared_ptr<T>(new T(std::forward<_Up>(value)));
+  }
+
+  single_thread_shared_ptr<T> _M_ptr;
+};
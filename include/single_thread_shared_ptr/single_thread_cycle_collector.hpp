@@ -0,0 +1,361 @@
+#pragma once
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if !defined(SINGLE_THREAD_SHARED_PTR_CYCLE_COLLECTOR)
+#error "define SINGLE_THREAD_SHARED_PTR_CYCLE_COLLECTOR for every translation unit to use the cycle collector"
+#endif
+
+#ifndef SINGLE_THREAD_SHARED_PTR_CYCLE_COLLECTOR_THRESHOLD
+#define SINGLE_THREAD_SHARED_PTR_CYCLE_COLLECTOR_THRESHOLD 4096
+#endif
+
+class single_thread_cycle_visitor;
+
+// Control block of an object created by make_single_thread_collectible. The
+// collector keeps its state next to the counts: the color of the trial
+// deletion, whether the block waits in the candidate buffer, and whether it
+// was released while waiting there (the buffer deletes it then).
+struct single_thread_collectible_block_base
+    : single_thread_shared_ptr_control_block {
+  using trace_fn = void (*)(single_thread_collectible_block_base *,
+                            single_thread_cycle_visitor &);
+
+  enum class color : unsigned char {
+    black,  // in use or free
+    gray,   // possible member of a cycle
+    white,  // member of a garbage cycle
+    purple, // possible root of a cycle
+    freeing // collected, its object is being destroyed
+  };
+
+  single_thread_collectible_block_base(manager_fn manager,
+                                       trace_fn trace) noexcept
+      : single_thread_shared_ptr_control_block{1, 1, manager}, _trace{trace} {
+    _collectible = true;
+  }
+
+  // the last weak reference is gone, buffered blocks are deleted by the
+  // buffer
+  bool keepForBuffer() noexcept {
+    if (!_buffered)
+      return false;
+    _dead = true;
+    return true;
+  }
+
+  void unbuffer() noexcept {
+    _buffered = false;
+    if (_dead)
+      _manager(this, single_thread_shared_ptr_block_op::destroy);
+  }
+
+  trace_fn _trace;
+  color _color{color::black};
+  bool _buffered{false};
+  bool _dead{false};
+};
+
+/// Passed to the trace() member of collectible objects, which has to call it
+/// with every single_thread_shared_ptr the object owns. Pointers to objects
+/// which were not created by make_single_thread_collectible are skipped,
+/// cycles through them are never collected.
+class single_thread_cycle_visitor {
+public:
+  template <typename _Tp>
+  void operator()(const single_thread_shared_ptr<_Tp> &p) {
+    auto *block = single_thread_shared_ptr_factory::block(p);
+    if (block && block->_collectible)
+      _children.push_back(
+          static_cast<single_thread_collectible_block_base *>(block));
+  }
+
+private:
+  friend class single_thread_cycle_collector;
+
+  std::vector<single_thread_collectible_block_base *> _children;
+};
+
+// Detects void T::trace(single_thread_cycle_visitor &) const
+template <typename _Tp, typename = void>
+struct __sp_is_traceable : std::false_type {};
+
+template <typename _Tp>
+struct __sp_is_traceable<
+    _Tp, std::void_t<decltype(std::declval<const _Tp &>().trace(
+             std::declval<single_thread_cycle_visitor &>()))>>
+    : std::true_type {};
+
+/// Per thread synchronous cycle collector (trial deletion after Bacon and
+/// Rajan) for objects created by make_single_thread_collectible. Whenever
+/// an owner of such an object is released and others are left, the object
+/// becomes a candidate root of a garbage cycle. collect() subtracts the
+/// references the candidates and everything reachable from them hold to
+/// each other; objects whose count drops to zero are only referenced from
+/// inside the graph and are destroyed, the counts of the others are put
+/// back. Once threshold() candidates are buffered the next
+/// make_single_thread_collectible collects first, never an assignment in
+/// progress, which might still read from an object of the cycle.
+/// Destructors of collected objects must not keep pointers to other objects
+/// of their cycle. Candidates left when the thread exits are not collected.
+class single_thread_cycle_collector {
+  using block = single_thread_collectible_block_base;
+  using color = block::color;
+
+public:
+  /// Destroy the garbage cycles reachable from the candidates, returns the
+  /// number of objects destroyed. Allocation failures of the collector's
+  /// work lists terminate. Does nothing when called by a destructor of a
+  /// collected object.
+  static std::size_t collect() noexcept {
+    auto &s = state();
+    if (s._collecting)
+      return 0;
+    s._collecting = true;
+    std::vector<block *> roots;
+    roots.swap(s._roots);
+    markRoots(s, roots);
+    for (block *root : roots)
+      scan(s, root);
+    std::vector<block *> garbage;
+    for (block *root : roots)
+      root->_buffered = false;
+    for (block *root : roots)
+      collectWhite(s, root, garbage);
+    freeCycles(s, garbage);
+    s._collecting = false;
+    return garbage.size();
+  }
+
+  /// Candidate roots waiting on the calling thread
+  static std::size_t size() noexcept { return state()._roots.size(); }
+
+  static std::size_t threshold() noexcept { return state()._threshold; }
+
+  static void setThreshold(std::size_t threshold) noexcept {
+    state()._threshold = threshold;
+  }
+
+  // an owner of b is gone but b is still in use
+  static void possibleRoot(block *b) noexcept {
+    if (b->_color == color::purple || b->_color == color::freeing)
+      return;
+    b->_color = color::purple;
+    if (b->_buffered)
+      return;
+    try {
+      state()._roots.push_back(b);
+      b->_buffered = true;
+    } catch (...) {
+      // left for a later release of one of its owners
+      b->_color = color::black;
+    }
+  }
+
+  // called before a collectible object is created
+  static void collectIfFull() noexcept {
+    auto &s = state();
+    if (s._roots.size() >= s._threshold)
+      collect();
+  }
+
+private:
+  struct State {
+    std::vector<block *> _roots;
+    std::size_t _threshold{SINGLE_THREAD_SHARED_PTR_CYCLE_COLLECTOR_THRESHOLD};
+    bool _collecting{false};
+    single_thread_cycle_visitor _visitor;
+    std::vector<block *> _stack;
+    std::vector<block *> _pending; // scan, which uses _stack for scanBlack
+
+    ~State() {
+      for (block *b : _roots)
+        b->unbuffer();
+    }
+  };
+
+  static State &state() noexcept {
+    thread_local State s;
+    return s;
+  }
+
+  // owned children of b, valid until the next call
+  static const std::vector<block *> &children(State &s, block *b) {
+    s._visitor._children.clear();
+    b->_trace(b, s._visitor);
+    return s._visitor._children;
+  }
+
+  // keeps the candidates which are still purple and in use, the others are
+  // dropped (and deleted when they were released meanwhile)
+  static void markRoots(State &s, std::vector<block *> &roots) {
+    std::size_t kept = 0;
+    for (block *b : roots) {
+      if (b->_color == color::purple && b->_count > 0) {
+        markGray(s, b);
+        roots[kept++] = b;
+      } else {
+        if (b->_color == color::purple)
+          b->_color = color::black;
+        b->unbuffer();
+      }
+    }
+    roots.resize(kept);
+  }
+
+  // subtracts the internal references of everything reachable from root
+  static void markGray(State &s, block *root) {
+    s._stack.push_back(root);
+    while (!s._stack.empty()) {
+      block *b = s._stack.back();
+      s._stack.pop_back();
+      if (b->_color == color::gray)
+        continue;
+      b->_color = color::gray;
+      for (block *child : children(s, b)) {
+        --child->_count;
+        if (child->_color != color::gray)
+          s._stack.push_back(child);
+      }
+    }
+  }
+
+  // gray blocks still referenced from outside are in use, the others are
+  // garbage
+  static void scan(State &s, block *root) {
+    auto &pending = s._pending;
+    pending.push_back(root);
+    while (!pending.empty()) {
+      block *b = pending.back();
+      pending.pop_back();
+      if (b->_color != color::gray)
+        continue;
+      if (b->_count > 0) {
+        scanBlack(s, b);
+        continue;
+      }
+      b->_color = color::white;
+      for (block *child : children(s, b))
+        pending.push_back(child);
+    }
+  }
+
+  // puts back the references of everything reachable from a block in use
+  static void scanBlack(State &s, block *root) {
+    s._stack.push_back(root);
+    while (!s._stack.empty()) {
+      block *b = s._stack.back();
+      s._stack.pop_back();
+      if (b->_color == color::black)
+        continue;
+      b->_color = color::black;
+      for (block *child : children(s, b)) {
+        ++child->_count;
+        if (child->_color != color::black)
+          s._stack.push_back(child);
+      }
+    }
+  }
+
+  static void collectWhite(State &s, block *root,
+                           std::vector<block *> &garbage) {
+    s._stack.push_back(root);
+    while (!s._stack.empty()) {
+      block *b = s._stack.back();
+      s._stack.pop_back();
+      if (b->_color != color::white || b->_buffered)
+        continue;
+      b->_color = color::freeing;
+      garbage.push_back(b);
+      for (block *child : children(s, b))
+        s._stack.push_back(child);
+    }
+  }
+
+  // The destructors release the references the objects hold, so the counts
+  // subtracted by the trial deletion are put back first. An extra count
+  // keeps every member of the garbage alive until all objects are
+  // destroyed, then the blocks are released like by their last owner.
+  static void freeCycles(State &s, const std::vector<block *> &garbage) {
+    for (block *b : garbage)
+      for (block *child : children(s, b))
+        ++child->_count;
+    for (block *b : garbage)
+      ++b->_count;
+    for (block *b : garbage) {
+      SINGLE_THREAD_SHARED_PTR_RECORD(onObjectDelete);
+      b->_manager(b, single_thread_shared_ptr_block_op::dispose);
+    }
+    for (block *b : garbage) {
+      b->_count = 0;
+      b->_color = color::black;
+      single_thread_shared_ptr_counter::releaseWeak(b);
+    }
+  }
+};
+
+// Collectible object and its counter in one allocation
+template <typename _Tp>
+struct single_thread_collectible_block : single_thread_collectible_block_base {
+  using object_type = std::remove_cv_t<_Tp>;
+
+  template <typename... _Args>
+  explicit single_thread_collectible_block(_Args &&...__args)
+      : single_thread_collectible_block_base{&manage, &trace} {
+    ::new (static_cast<void *>(std::addressof(_object)))
+        object_type(std::forward<_Args>(__args)...);
+  }
+
+  ~single_thread_collectible_block() {}
+
+  _Tp *ptr() noexcept { return std::addressof(_object); }
+
+  static void trace(single_thread_collectible_block_base *b,
+                    single_thread_cycle_visitor &visitor) {
+    static_cast<single_thread_collectible_block *>(b)->_object.trace(visitor);
+  }
+
+  static void manage(single_thread_shared_ptr_control_block *cb,
+                     single_thread_shared_ptr_block_op op) noexcept {
+    auto *self = static_cast<single_thread_collectible_block *>(cb);
+    switch (op) {
+    case single_thread_shared_ptr_block_op::dispose:
+      self->_object.~object_type();
+      break;
+    case single_thread_shared_ptr_block_op::destroy:
+      if (!self->keepForBuffer())
+        delete self;
+      break;
+    case single_thread_shared_ptr_block_op::possible_root:
+      single_thread_cycle_collector::possibleRoot(self);
+      break;
+    }
+  }
+
+  union {
+    object_type _object;
+  };
+};
+
+/// Create an object whose cycles single_thread_cycle_collector can destroy.
+/// _Tp needs a member void trace(single_thread_cycle_visitor &visit) const
+/// calling visit(ptr) for every single_thread_shared_ptr it owns.
+template <typename _Tp, typename... _Args>
+inline std::enable_if_t<!std::is_array_v<_Tp>, single_thread_shared_ptr<_Tp>>
+make_single_thread_collectible(_Args &&...__args) {
+  static_assert(__sp_is_traceable<std::remove_cv_t<_Tp>>::value,
+                "collectible types need a trace(single_thread_cycle_visitor &) "
+                "const member");
+  single_thread_cycle_collector::collectIfFull();
+  auto *block = new single_thread_collectible_block<_Tp>(
+      std::forward<_Args>(__args)...);
+  SINGLE_THREAD_SHARED_PTR_RECORD(onCounterAllocation);
+  return single_thread_shared_ptr_factory::adopt<_Tp>(block->ptr(), block);
+}
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+/// Base class keeping a NON THREAD SAFE reference count inside the object.
+/// Derived is deleted through its own type when the last
+/// single_thread_intrusive_ptr goes away, so no virtual destructor is needed.
+template <typename Derived> class single_thread_intrusive_ref_counter {
+public:
+  unsigned use_count() const noexcept { return _ref_count; }
+
+protected:
+  constexpr single_thread_intrusive_ref_counter() noexcept = default;
+
+  // copies are new objects, they do not share the count
+  constexpr single_thread_intrusive_ref_counter(
+      const single_thread_intrusive_ref_counter &) noexcept {}
+
+  single_thread_intrusive_ref_counter &
+  operator=(const single_thread_intrusive_ref_counter &) noexcept {
+    return *this;
+  }
+
+  ~single_thread_intrusive_ref_counter() = default;
+
+private:
+  friend void
+  intrusive_ptr_add_ref(const single_thread_intrusive_ref_counter *p) noexcept {
+    ++p->_ref_count;
+  }
+
+  friend void
+  intrusive_ptr_release(const single_thread_intrusive_ref_counter *p) noexcept {
+    if (--p->_ref_count == 0)
+      delete static_cast<const Derived *>(p);
+  }
+
+  friend unsigned intrusive_ptr_use_count(
+      const single_thread_intrusive_ref_counter *p) noexcept {
+    return p->_ref_count;
+  }
+
+  mutable unsigned _ref_count{0};
+};
+
+/// Hooks used by single_thread_intrusive_ptr. The default forwards to the
+/// intrusive_ptr_add_ref / intrusive_ptr_release / intrusive_ptr_use_count
+/// functions found by ADL (provided by single_thread_intrusive_ref_counter);
+/// specialize it for types which keep their count in some other way.
+template <typename _Tp> struct single_thread_intrusive_ptr_traits {
+  static void add_ref(_Tp *p) noexcept { intrusive_ptr_add_ref(p); }
+  static void release(_Tp *p) noexcept { intrusive_ptr_release(p); }
+  static long use_count(const _Tp *p) noexcept {
+    return intrusive_ptr_use_count(p);
+  }
+};
+
+/// One word, NON THREAD SAFE pointer to an object which embeds its own
+/// reference count.
+template <typename T> class single_thread_intrusive_ptr {
+private:
+  using traits = single_thread_intrusive_ptr_traits<T>;
+
+  template <typename _Yp>
+  using _Compatible =
+      typename std::enable_if<std::is_convertible<_Yp *, T *>::value>::type;
+
+public:
+  using element_type = T;
+  using trivially_relocatable = std::true_type;
+
+  constexpr single_thread_intrusive_ptr() noexcept : _M_ptr{nullptr} {}
+
+  // add_ref == false adopts a reference which was already counted
+  single_thread_intrusive_ptr(T *ptr, bool add_ref = true) noexcept
+      : _M_ptr{ptr} {
+    if (_M_ptr && add_ref)
+      traits::add_ref(_M_ptr);
+  }
+
+  single_thread_intrusive_ptr(const single_thread_intrusive_ptr &rhs) noexcept
+      : single_thread_intrusive_ptr(rhs._M_ptr) {}
+
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  single_thread_intrusive_ptr(
+      const single_thread_intrusive_ptr<_Yp> &rhs) noexcept
+      : single_thread_intrusive_ptr(rhs.get()) {}
+
+  single_thread_intrusive_ptr(single_thread_intrusive_ptr &&rhs) noexcept
+      : _M_ptr{std::exchange(rhs._M_ptr, nullptr)} {}
+
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  single_thread_intrusive_ptr(single_thread_intrusive_ptr<_Yp> &&rhs) noexcept
+      : _M_ptr{rhs.detach()} {}
+
+  single_thread_intrusive_ptr &
+  operator=(const single_thread_intrusive_ptr &rhs) noexcept {
+    single_thread_intrusive_ptr(rhs).swap(*this);
+    return *this;
+  }
+
+  single_thread_intrusive_ptr &
+  operator=(single_thread_intrusive_ptr &&rhs) noexcept {
+    single_thread_intrusive_ptr(std::move(rhs)).swap(*this);
+    return *this;
+  }
+
+  single_thread_intrusive_ptr &operator=(T *rhs) noexcept {
+    single_thread_intrusive_ptr(rhs).swap(*this);
+    return *this;
+  }
+
+  ~single_thread_intrusive_ptr() noexcept {
+    if (_M_ptr)
+      traits::release(_M_ptr);
+  }
+
+  T &operator*() const noexcept {
+    assert(_M_ptr != nullptr);
+    return *_M_ptr;
+  }
+
+  T *operator->() const noexcept { return _M_ptr; }
+
+  T *get() const noexcept { return _M_ptr; }
+
+  long use_count() const noexcept {
+    return _M_ptr ? traits::use_count(_M_ptr) : 0;
+  }
+
+  /// Give up ownership without decrementing the count
+  T *detach() noexcept { return std::exchange(_M_ptr, nullptr); }
+
+  void reset() noexcept { single_thread_intrusive_ptr{}.swap(*this); }
+
+  void reset(T *rhs, bool add_ref = true) noexcept {
+    single_thread_intrusive_ptr(rhs, add_ref).swap(*this);
+  }
+
+  void swap(single_thread_intrusive_ptr &rhs) noexcept {
+    std::swap(_M_ptr, rhs._M_ptr);
+  }
+
+  explicit operator bool() const noexcept { return _M_ptr == 0 ? false : true; }
+
+private:
+  T *_M_ptr;
+};
+
+/// Create an object and the first pointer to it
+template <typename _Tp, typename... _Args>
+inline single_thread_intrusive_ptr<_Tp>
+make_single_thread_intrusive(_Args &&...__args) {
+  return single_thread_intrusive_ptr<_Tp>(
+      new _Tp(std::forward<_Args>(__args)...));
+}
+
+/// Equality operator for intrusive_ptr objects, compares the stored pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator==(const single_thread_intrusive_ptr<_Tp> &__a,
+           const single_thread_intrusive_ptr<_Up> &__b) noexcept {
+  return __a.get() == __b.get();
+}
+
+/// intrusive_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator==(const single_thread_intrusive_ptr<_Tp> &__a,
+           std::nullptr_t) noexcept {
+  return !__a;
+}
+
+/// intrusive_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator==(std::nullptr_t,
+           const single_thread_intrusive_ptr<_Tp> &__a) noexcept {
+  return !__a;
+}
+
+/// Inequality operator for intrusive_ptr objects, compares the stored pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator!=(const single_thread_intrusive_ptr<_Tp> &__a,
+           const single_thread_intrusive_ptr<_Up> &__b) noexcept {
+  return __a.get() != __b.get();
+}
+
+/// intrusive_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator!=(const single_thread_intrusive_ptr<_Tp> &__a,
+           std::nullptr_t) noexcept {
+  return (bool)__a;
+}
+
+/// intrusive_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator!=(std::nullptr_t,
+           const single_thread_intrusive_ptr<_Tp> &__a) noexcept {
+  return (bool)__a;
+}
+
+/// Relational operator for intrusive_ptr objects, compares the stored pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator<(const single_thread_intrusive_ptr<_Tp> &__a,
+          const single_thread_intrusive_ptr<_Up> &__b) noexcept {
+  using _Vp = std::common_type_t<_Tp *, _Up *>;
+  return std::less<_Vp>()(__a.get(), __b.get());
+}
+
+/// intrusive_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator<(const single_thread_intrusive_ptr<_Tp> &__a,
+          std::nullptr_t) noexcept {
+  return std::less<_Tp *>()(__a.get(), nullptr);
+}
+
+/// intrusive_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator<(std::nullptr_t,
+          const single_thread_intrusive_ptr<_Tp> &__a) noexcept {
+  return std::less<_Tp *>()(nullptr, __a.get());
+}
+
+/// Relational operator for intrusive_ptr objects, compares the stored pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator<=(const single_thread_intrusive_ptr<_Tp> &__a,
+           const single_thread_intrusive_ptr<_Up> &__b) noexcept {
+  return !(__b < __a);
+}
+
+/// intrusive_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator<=(const single_thread_intrusive_ptr<_Tp> &__a,
+           std::nullptr_t) noexcept {
+  return !(nullptr < __a);
+}
+
+/// intrusive_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator<=(std::nullptr_t,
+           const single_thread_intrusive_ptr<_Tp> &__a) noexcept {
+  return !(__a < nullptr);
+}
+
+/// Relational operator for intrusive_ptr objects, compares the stored pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator>(const single_thread_intrusive_ptr<_Tp> &__a,
+          const single_thread_intrusive_ptr<_Up> &__b) noexcept {
+  return (__b < __a);
+}
+
+/// intrusive_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator>(const single_thread_intrusive_ptr<_Tp> &__a,
+          std::nullptr_t) noexcept {
+  return nullptr < __a;
+}
+
+/// intrusive_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator>(std::nullptr_t,
+          const single_thread_intrusive_ptr<_Tp> &__a) noexcept {
+  return __a < nullptr;
+}
+
+/// Relational operator for intrusive_ptr objects, compares the stored pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator>=(const single_thread_intrusive_ptr<_Tp> &__a,
+           const single_thread_intrusive_ptr<_Up> &__b) noexcept {
+  return !(__a < __b);
+}
+
+/// intrusive_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator>=(const single_thread_intrusive_ptr<_Tp> &__a,
+           std::nullptr_t) noexcept {
+  return !(__a < nullptr);
+}
+
+/// intrusive_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator>=(std::nullptr_t,
+           const single_thread_intrusive_ptr<_Tp> &__a) noexcept {
+  return !(nullptr < __a);
+}
+
+namespace std {
+template <typename _Tp> struct hash<single_thread_intrusive_ptr<_Tp>> {
+  size_t operator()(const single_thread_intrusive_ptr<_Tp> &s) const noexcept {
+    return std::hash<_Tp *>()(s.get());
+  }
+};
+} // namespace std
@@ -0,0 +1,426 @@
+#pragma once
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+struct single_thread_local_shared_block;
+
+// Owners of an object on one thread. The thread which created the object
+// uses the count inside the shared block, other threads allocate theirs from
+// single_thread_shared_ptr_counter_allocator.
+struct single_thread_local_count {
+  unsigned _count;
+  single_thread_local_shared_block *_shared;
+};
+
+// Thread safe side of a single_thread_local_shared_ptr: _threads counts the
+// threads holding the object plus the single_thread_cross_thread_ptr in
+// flight, the last one calls _destroy which deletes the object and the
+// block.
+struct single_thread_local_shared_block {
+  using destroy_fn = single_thread_shared_ptr_reclamation::destroy_fn;
+
+  explicit single_thread_local_shared_block(destroy_fn destroy) noexcept
+      : _destroy{destroy} {}
+
+  single_thread_local_shared_block(const single_thread_local_shared_block &) =
+      delete;
+  single_thread_local_shared_block &
+  operator=(const single_thread_local_shared_block &) = delete;
+
+  void acquire() noexcept { _threads.fetch_add(1, std::memory_order_relaxed); }
+
+  void release() noexcept {
+    if (_threads.fetch_sub(1, std::memory_order_acq_rel) != 1)
+      return;
+    if constexpr (single_thread_shared_ptr_reclamation::enabled)
+      single_thread_shared_ptr_reclamation::defer(this, _destroy);
+    else
+      _destroy(this);
+  }
+
+  // local count for another thread, takes over one count of _threads which
+  // is given back when the allocation fails. Counts are not looked up per
+  // thread: every handoff a thread receives gets a count of its own and
+  // gives its thread count back when its last owner is gone.
+  single_thread_local_count *attach() {
+    static_assert(sizeof(single_thread_local_count) <=
+                      sizeof(single_thread_shared_ptr_control_block),
+                  "local counts share the cells of promoted counters");
+    try {
+      return ::new (single_thread_shared_ptr_counter_allocator::allocate())
+          single_thread_local_count{1, this};
+    } catch (...) {
+      release();
+      throw;
+    }
+  }
+
+  // the last owner on a thread is gone
+  static SINGLE_THREAD_SHARED_PTR_NOINLINE void
+  detach(single_thread_local_count *local) noexcept {
+    auto *shared = local->_shared;
+    if (local != &shared->_first)
+      single_thread_shared_ptr_counter_allocator::deallocate(local);
+    shared->release();
+  }
+
+  std::atomic<long> _threads{1};
+  destroy_fn _destroy;
+  single_thread_local_count _first{1, this};
+};
+
+// Object created by make_single_thread_local_shared and its blocks in one
+// allocation
+template <typename _Tp>
+struct single_thread_local_shared_inplace_block
+    : single_thread_local_shared_block {
+  using object_type = std::remove_cv_t<_Tp>;
+
+  template <typename... _Args>
+  explicit single_thread_local_shared_inplace_block(_Args &&...__args)
+      : single_thread_local_shared_block{&destroy} {
+    ::new (static_cast<void *>(std::addressof(_object)))
+        object_type(std::forward<_Args>(__args)...);
+  }
+
+  ~single_thread_local_shared_inplace_block() {}
+
+  _Tp *ptr() noexcept { return std::addressof(_object); }
+
+  static void destroy(void *block) noexcept {
+    auto *self = static_cast<single_thread_local_shared_inplace_block *>(
+        static_cast<single_thread_local_shared_block *>(block));
+    self->_object.~object_type();
+    delete self;
+  }
+
+  union {
+    object_type _object;
+  };
+};
+
+// Blocks of an object adopted through a raw pointer
+template <typename _Tp>
+struct single_thread_local_shared_pointer_block
+    : single_thread_local_shared_block {
+  explicit single_thread_local_shared_pointer_block(_Tp *ptr) noexcept
+      : single_thread_local_shared_block{&destroy}, _ptr{ptr} {}
+
+  static void destroy(void *block) noexcept {
+    auto *self = static_cast<single_thread_local_shared_pointer_block *>(
+        static_cast<single_thread_local_shared_block *>(block));
+    delete self->_ptr;
+    delete self;
+  }
+
+  _Tp *_ptr;
+};
+
+template <typename _Tp> class single_thread_local_shared_ptr;
+template <typename _Tp> class single_thread_cross_thread_ptr;
+
+/// Thread safe pointer carrying an object of single_thread_local_shared_ptr
+/// to another thread. It holds one count of the atomic thread count and is
+/// turned into a single_thread_local_shared_ptr on the receiving thread;
+/// moving it into that pointer hands the count over without an atomic
+/// operation.
+template <typename T> class single_thread_cross_thread_ptr {
+private:
+  template <typename _Yp>
+  using _Compatible =
+      typename std::enable_if<std::is_convertible<_Yp *, T *>::value>::type;
+
+public:
+  using element_type = T;
+  using trivially_relocatable = std::true_type;
+
+  constexpr single_thread_cross_thread_ptr() noexcept
+      : _M_ptr{nullptr}, _shared{nullptr} {}
+
+  single_thread_cross_thread_ptr(const single_thread_cross_thread_ptr &rhs) noexcept
+      : _M_ptr{rhs._M_ptr}, _shared{acquire(rhs._shared)} {}
+
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  single_thread_cross_thread_ptr(
+      const single_thread_cross_thread_ptr<_Yp> &rhs) noexcept
+      : _M_ptr{rhs._M_ptr}, _shared{acquire(rhs._shared)} {}
+
+  single_thread_cross_thread_ptr(single_thread_cross_thread_ptr &&rhs) noexcept
+      : _M_ptr{std::exchange(rhs._M_ptr, nullptr)},
+        _shared{std::exchange(rhs._shared, nullptr)} {}
+
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  single_thread_cross_thread_ptr(
+      single_thread_cross_thread_ptr<_Yp> &&rhs) noexcept
+      : _M_ptr{std::exchange(rhs._M_ptr, nullptr)},
+        _shared{std::exchange(rhs._shared, nullptr)} {}
+
+  single_thread_cross_thread_ptr &
+  operator=(const single_thread_cross_thread_ptr &rhs) noexcept {
+    single_thread_cross_thread_ptr(rhs).swap(*this);
+    return *this;
+  }
+
+  single_thread_cross_thread_ptr &
+  operator=(single_thread_cross_thread_ptr &&rhs) noexcept {
+    single_thread_cross_thread_ptr(std::move(rhs)).swap(*this);
+    return *this;
+  }
+
+  ~single_thread_cross_thread_ptr() noexcept {
+    if (_shared)
+      _shared->release();
+  }
+
+  T *get() const noexcept { return _M_ptr; }
+
+  void reset() noexcept { single_thread_cross_thread_ptr{}.swap(*this); }
+
+  void swap(single_thread_cross_thread_ptr &rhs) noexcept {
+    std::swap(_M_ptr, rhs._M_ptr);
+    std::swap(_shared, rhs._shared);
+  }
+
+  explicit operator bool() const noexcept { return _M_ptr == 0 ? false : true; }
+
+  template <typename _Yp> friend class single_thread_cross_thread_ptr;
+  template <typename _Yp> friend class single_thread_local_shared_ptr;
+
+private:
+  // adopts a count of _threads
+  single_thread_cross_thread_ptr(T *ptr,
+                                 single_thread_local_shared_block *shared) noexcept
+      : _M_ptr{ptr}, _shared{shared} {}
+
+  static single_thread_local_shared_block *
+  acquire(single_thread_local_shared_block *shared) noexcept {
+    if (shared)
+      shared->acquire();
+    return shared;
+  }
+
+  T *_M_ptr;
+  single_thread_local_shared_block *_shared;
+};
+
+/// Shared pointer for objects used mostly on one thread but sometimes shared
+/// with others. Owners on the same thread share a NON THREAD SAFE count, so
+/// copies within a thread cost a plain increment; an atomic count tracks the
+/// threads holding the object and is only touched by the first and the last
+/// owner on each thread. Pass the object to another thread with
+/// to_thread(), never by copying a single_thread_local_shared_ptr across
+/// threads. Each pointer constructed from a single_thread_cross_thread_ptr
+/// starts a separate local count, even when its thread already holds the
+/// object; copy the local owner instead of handing the object over twice.
+template <typename T> class single_thread_local_shared_ptr {
+private:
+  static_assert(!std::is_array_v<T>, "arrays are not supported");
+
+  template <typename _Yp>
+  using _Compatible =
+      typename std::enable_if<std::is_convertible<_Yp *, T *>::value>::type;
+
+public:
+  using element_type = T;
+  using trivially_relocatable = std::true_type;
+
+  constexpr single_thread_local_shared_ptr() noexcept
+      : _M_ptr{nullptr}, _local{nullptr} {}
+
+  constexpr single_thread_local_shared_ptr(std::nullptr_t) noexcept
+      : _M_ptr{nullptr}, _local{nullptr} {}
+
+  /// Take ownership of ptr, deleted with delete. The object is deleted when
+  /// allocating its blocks fails.
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  explicit single_thread_local_shared_ptr(_Yp *ptr) : _M_ptr{ptr}, _local{nullptr} {
+    static_assert(sizeof(_Yp) > 0, "incomplete type");
+    if (!ptr)
+      return;
+    try {
+      _local = &(new single_thread_local_shared_pointer_block<_Yp>(ptr))->_first;
+    } catch (...) {
+      delete ptr;
+      throw;
+    }
+  }
+
+  single_thread_local_shared_ptr(const single_thread_local_shared_ptr &rhs) noexcept
+      : _M_ptr{rhs._M_ptr}, _local{acquire(rhs._local)} {}
+
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  single_thread_local_shared_ptr(
+      const single_thread_local_shared_ptr<_Yp> &rhs) noexcept
+      : _M_ptr{rhs._M_ptr}, _local{acquire(rhs._local)} {}
+
+  single_thread_local_shared_ptr(single_thread_local_shared_ptr &&rhs) noexcept
+      : _M_ptr{std::exchange(rhs._M_ptr, nullptr)},
+        _local{std::exchange(rhs._local, nullptr)} {}
+
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  single_thread_local_shared_ptr(single_thread_local_shared_ptr<_Yp> &&rhs) noexcept
+      : _M_ptr{std::exchange(rhs._M_ptr, nullptr)},
+        _local{std::exchange(rhs._local, nullptr)} {}
+
+  /// First owner on the calling thread of an object from another thread
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  explicit single_thread_local_shared_ptr(
+      const single_thread_cross_thread_ptr<_Yp> &rhs)
+      : _M_ptr{rhs._M_ptr}, _local{nullptr} {
+    if (rhs._shared) {
+      rhs._shared->acquire();
+      _local = rhs._shared->attach();
+    }
+  }
+
+  /// Like the copy from a cross thread pointer, but takes over its count
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  explicit single_thread_local_shared_ptr(single_thread_cross_thread_ptr<_Yp> &&rhs)
+      : _M_ptr{rhs._M_ptr}, _local{nullptr} {
+    if (auto *shared = std::exchange(rhs._shared, nullptr)) {
+      rhs._M_ptr = nullptr;
+      _local = shared->attach();
+    }
+  }
+
+  single_thread_local_shared_ptr &
+  operator=(const single_thread_local_shared_ptr &rhs) noexcept {
+    single_thread_local_shared_ptr(rhs).swap(*this);
+    return *this;
+  }
+
+  single_thread_local_shared_ptr &
+  operator=(single_thread_local_shared_ptr &&rhs) noexcept {
+    single_thread_local_shared_ptr(std::move(rhs)).swap(*this);
+    return *this;
+  }
+
+  ~single_thread_local_shared_ptr() noexcept {
+    if (_local && --_local->_count == 0)
+      single_thread_local_shared_block::detach(_local);
+  }
+
+  T &operator*() const noexcept {
+    assert(_M_ptr != nullptr);
+    return *_M_ptr;
+  }
+
+  T *operator->() const noexcept { return _M_ptr; }
+
+  T *get() const noexcept { return _M_ptr; }
+
+  /// Owners on the calling thread
+  long local_use_count() const noexcept { return _local ? _local->_count : 0; }
+
+  /// Threads holding the object plus cross thread pointers, a snapshot when
+  /// other threads hold the object
+  long thread_count() const noexcept {
+    return _local ? _local->_shared->_threads.load(std::memory_order_relaxed)
+                  : 0;
+  }
+
+  /// Pointer to pass the object to another thread, costs one atomic
+  /// increment
+  single_thread_cross_thread_ptr<T> to_thread() const noexcept {
+    if (!_local)
+      return {};
+    _local->_shared->acquire();
+    return single_thread_cross_thread_ptr<T>(_M_ptr, _local->_shared);
+  }
+
+  void reset() noexcept { single_thread_local_shared_ptr{}.swap(*this); }
+
+  template <typename _Yp> _Compatible<_Yp> reset(_Yp *ptr) {
+    single_thread_local_shared_ptr(ptr).swap(*this);
+  }
+
+  void swap(single_thread_local_shared_ptr &rhs) noexcept {
+    std::swap(_M_ptr, rhs._M_ptr);
+    std::swap(_local, rhs._local);
+  }
+
+  explicit operator bool() const noexcept { return _M_ptr == 0 ? false : true; }
+
+  template <typename _Yp> friend class single_thread_local_shared_ptr;
+
+  template <typename _Tp, typename... _Args>
+  friend single_thread_local_shared_ptr<_Tp>
+  make_single_thread_local_shared(_Args &&...__args);
+
+private:
+  // adopts the first owner of a new block
+  single_thread_local_shared_ptr(T *ptr, single_thread_local_count *local) noexcept
+      : _M_ptr{ptr}, _local{local} {}
+
+  static single_thread_local_count *
+  acquire(single_thread_local_count *local) noexcept {
+    if (local)
+      ++local->_count;
+    return local;
+  }
+
+  T *_M_ptr;
+  single_thread_local_count *_local;
+};
+
+/// Create an object together with its thread count and the local count of
+/// the calling thread in one allocation
+template <typename _Tp, typename... _Args>
+inline single_thread_local_shared_ptr<_Tp>
+make_single_thread_local_shared(_Args &&...__args) {
+  auto *block = new single_thread_local_shared_inplace_block<_Tp>(
+      std::forward<_Args>(__args)...);
+  return single_thread_local_shared_ptr<_Tp>(block->ptr(), &block->_first);
+}
+
+/// Equality operator for local_shared_ptr objects, compares the stored
+/// pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator==(const single_thread_local_shared_ptr<_Tp> &__a,
+           const single_thread_local_shared_ptr<_Up> &__b) noexcept {
+  return __a.get() == __b.get();
+}
+
+/// local_shared_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator==(const single_thread_local_shared_ptr<_Tp> &__a,
+           std::nullptr_t) noexcept {
+  return !__a;
+}
+
+/// Inequality operator for local_shared_ptr objects, compares the stored
+/// pointers
+template <typename _Tp, typename _Up>
+[[nodiscard]] inline bool
+operator!=(const single_thread_local_shared_ptr<_Tp> &__a,
+           const single_thread_local_shared_ptr<_Up> &__b) noexcept {
+  return __a.get() != __b.get();
+}
+
+/// local_shared_ptr comparison with nullptr
+template <typename _Tp>
+[[nodiscard]] inline bool
+operator!=(const single_thread_local_shared_ptr<_Tp> &__a,
+           std::nullptr_t) noexcept {
+  return (bool)__a;
+}
+
+namespace std {
+template <typename _Tp> struct hash<single_thread_local_shared_ptr<_Tp>> {
+  size_t
+  operator()(const single_thread_local_shared_ptr<_Tp> &s) const noexcept {
+    return std::hash<_Tp *>()(s.get());
+  }
+};
+} // namespace std
@@ -0,0 +1,650 @@
+#pragma once
+
+#include <single_thread_shared_ptr/single_thread_intrusive_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+inline unsigned __sp_popcount(std::uint32_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_popcount(x));
+#else
+  x = x - ((x >> 1) & 0x55555555u);
+  x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+  return (((x + (x >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24;
+#endif
+}
+
+// Node of a single_thread_persistent_map, laid out like CHAMP: _datamap
+// marks the hash fragments of this level holding an entry, _nodemap those
+// leading to a child, both stored in fragment order behind the header in
+// the node's one allocation. Keys whose whole hash is equal end up in a
+// collision node below the last level, which lists them in any order.
+// The child slots are constructed when the node is created, the entries
+// are added by emplace(), so a node which failed to fill is destroyed with
+// the entries it got.
+template <typename _Value> struct single_thread_persistent_map_node {
+  using ptr = single_thread_intrusive_ptr<single_thread_persistent_map_node>;
+
+  static ptr create(unsigned children, unsigned entries,
+                    std::uint32_t datamap, std::uint32_t nodemap,
+                    bool collision = false) {
+    void *memory = ::operator new(entriesOffset(children) +
+                                      entries * sizeof(_Value),
+                                  std::align_val_t{alignment()});
+    auto *n = ::new (memory) single_thread_persistent_map_node;
+    n->_datamap = datamap;
+    n->_nodemap = nodemap;
+    n->_collision = collision;
+    for (; n->_children < children; ++n->_children)
+      ::new (static_cast<void *>(n->children() + n->_children)) ptr();
+    return ptr(n);
+  }
+
+  static void destroy(single_thread_persistent_map_node *n) noexcept {
+    while (n->_entries)
+      n->entries()[--n->_entries].~_Value();
+    while (n->_children)
+      n->children()[--n->_children].~ptr();
+    n->~single_thread_persistent_map_node();
+    ::operator delete(n, std::align_val_t{alignment()});
+  }
+
+  template <typename... _Args> void emplace(_Args &&...__args) {
+    ::new (static_cast<void *>(entries() + _entries))
+        _Value(std::forward<_Args>(__args)...);
+    ++_entries;
+  }
+
+  ptr *children() noexcept {
+    return reinterpret_cast<ptr *>(reinterpret_cast<char *>(this) +
+                                   childrenOffset());
+  }
+
+  const ptr *children() const noexcept {
+    return const_cast<single_thread_persistent_map_node *>(this)->children();
+  }
+
+  _Value *entries() noexcept {
+    return reinterpret_cast<_Value *>(reinterpret_cast<char *>(this) +
+                                      entriesOffset(_children));
+  }
+
+  const _Value *entries() const noexcept {
+    return const_cast<single_thread_persistent_map_node *>(this)->entries();
+  }
+
+  static constexpr std::size_t alignUp(std::size_t n, std::size_t a) {
+    return (n + a - 1) / a * a;
+  }
+
+  static constexpr std::size_t alignment() {
+    return std::max({alignof(single_thread_persistent_map_node), alignof(ptr),
+                     alignof(_Value)});
+  }
+
+  static constexpr std::size_t childrenOffset() {
+    return alignUp(sizeof(single_thread_persistent_map_node), alignof(ptr));
+  }
+
+  static constexpr std::size_t entriesOffset(unsigned children) {
+    return alignUp(childrenOffset() + children * sizeof(ptr), alignof(_Value));
+  }
+
+  unsigned _ref_count{0};
+  std::uint32_t _datamap{0};
+  std::uint32_t _nodemap{0};
+  unsigned _children{0};
+  unsigned _entries{0};
+  bool _collision{false};
+};
+
+template <typename _Value>
+struct single_thread_intrusive_ptr_traits<
+    single_thread_persistent_map_node<_Value>> {
+  using node = single_thread_persistent_map_node<_Value>;
+
+  static void add_ref(node *p) noexcept { ++p->_ref_count; }
+  static void release(node *p) noexcept {
+    if (--p->_ref_count == 0)
+      node::destroy(p);
+  }
+  static long use_count(const node *p) noexcept { return p->_ref_count; }
+};
+
+/// NON THREAD SAFE persistent hash map (hash array mapped trie, 32 way,
+/// CHAMP layout). Copies are O(1) and share all nodes; a change copies only
+/// the nodes on its path which are shared with another version, which the
+/// node counts tell, and updates the others in place. A batch of changes to
+/// one copy therefore copies each path once, and a map nobody shares never
+/// copies an entry. Entries are read only through the map, insert_or_assign()
+/// and update() change them. Iteration order is unspecified.
+template <typename K, typename V, typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>>
+class single_thread_persistent_map {
+public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<K, V>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using reference = const value_type &;
+  using const_reference = const value_type &;
+
+  class const_iterator;
+  using iterator = const_iterator;
+
+private:
+  using node = single_thread_persistent_map_node<value_type>;
+  using node_ptr = typename node::ptr;
+
+  static constexpr unsigned bits = 5;
+  static constexpr unsigned hash_bits = sizeof(std::size_t) * 8;
+  // levels indexed by a hash fragment and the collision level
+  static constexpr unsigned max_depth = (hash_bits + bits - 1) / bits + 1;
+
+  // entries are moved out of a node only when nothing can throw meanwhile
+  static constexpr bool nothrow_move =
+      std::is_nothrow_move_constructible_v<value_type>;
+
+public:
+  single_thread_persistent_map() = default;
+
+  explicit single_thread_persistent_map(const Hash &hash,
+                                        const KeyEqual &equal = KeyEqual())
+      : _hash{hash}, _equal{equal} {}
+
+  single_thread_persistent_map(std::initializer_list<value_type> values) {
+    for (const auto &v : values)
+      insert(v);
+  }
+
+  single_thread_persistent_map(const single_thread_persistent_map &) = default;
+
+  // a moved from map is empty and keeps its hash and key equality
+  single_thread_persistent_map(single_thread_persistent_map &&rhs) noexcept(
+      std::is_nothrow_copy_constructible_v<Hash> &&
+      std::is_nothrow_copy_constructible_v<KeyEqual>)
+      : _root{std::move(rhs._root)}, _size{std::exchange(rhs._size, 0)},
+        _hash{rhs._hash}, _equal{rhs._equal} {}
+
+  single_thread_persistent_map &
+  operator=(const single_thread_persistent_map &) = default;
+
+  single_thread_persistent_map &
+  operator=(single_thread_persistent_map &&rhs) noexcept(
+      std::is_nothrow_copy_constructible_v<Hash> &&
+      std::is_nothrow_copy_constructible_v<KeyEqual>) {
+    single_thread_persistent_map(std::move(rhs)).swap(*this);
+    return *this;
+  }
+
+  size_type size() const noexcept { return _size; }
+  bool empty() const noexcept { return _size == 0; }
+
+  hasher hash_function() const { return _hash; }
+  key_equal key_eq() const { return _equal; }
+
+  const_iterator begin() const noexcept { return const_iterator(_root.get()); }
+  const_iterator end() const noexcept { return const_iterator(); }
+
+  const_iterator find(const K &key) const {
+    const_iterator it;
+    if (!_root)
+      return it;
+    std::size_t h = _hash(key);
+    const node *n = _root.get();
+    for (unsigned shift = 0;; shift += bits) {
+      if (n->_collision) {
+        for (unsigned i = 0; i < n->_entries; ++i)
+          if (_equal(n->entries()[i].first, key))
+            return it.at(n, i);
+        return const_iterator();
+      }
+      std::uint32_t bit = bitFor(h, shift);
+      if (n->_datamap & bit) {
+        unsigned i = index(n->_datamap, bit);
+        if (!_equal(n->entries()[i].first, key))
+          return const_iterator();
+        return it.at(n, i);
+      }
+      if (!(n->_nodemap & bit))
+        return const_iterator();
+      unsigned child = index(n->_nodemap, bit);
+      it.push(n, child + 1);
+      n = n->children()[child].get();
+    }
+  }
+
+  bool contains(const K &key) const { return lookup(key) != nullptr; }
+  size_type count(const K &key) const { return contains(key) ? 1 : 0; }
+
+  const V &at(const K &key) const {
+    auto *entry = lookup(key);
+    if (!entry)
+      throw std::out_of_range("single_thread_persistent_map::at");
+    return entry->second;
+  }
+
+  /// Add the entry unless its key is present, returns true when it was added
+  bool insert(const value_type &value) {
+    return put(value.first, value.second, false);
+  }
+
+  bool insert(value_type &&value) {
+    return put(std::move(value.first), std::move(value.second), false);
+  }
+
+  /// Add or replace the value of key, returns true when it was added
+  template <typename _Mp> bool insert_or_assign(const K &key, _Mp &&value) {
+    return put(key, std::forward<_Mp>(value), true);
+  }
+
+  template <typename _Mp> bool insert_or_assign(K &&key, _Mp &&value) {
+    return put(std::move(key), std::forward<_Mp>(value), true);
+  }
+
+  /// f(V &) with the value of key, returns false when key is missing
+  template <typename _Fn> bool update(const K &key, _Fn &&f) {
+    if (!lookup(key))
+      return false;
+    std::invoke(std::forward<_Fn>(f), writable(key));
+    return true;
+  }
+
+  size_type erase(const K &key) {
+    // a missing key leaves every node shared
+    if (!lookup(key))
+      return 0;
+    remove(_root, 0, _hash(key), key);
+    if (_root->_entries == 0 && _root->_children == 0)
+      _root.reset();
+    --_size;
+    return 1;
+  }
+
+  void clear() noexcept {
+    _root.reset();
+    _size = 0;
+  }
+
+  void swap(single_thread_persistent_map &rhs) noexcept {
+    using std::swap;
+    _root.swap(rhs._root);
+    swap(_size, rhs._size);
+    swap(_hash, rhs._hash);
+    swap(_equal, rhs._equal);
+  }
+
+private:
+  static std::uint32_t bitFor(std::size_t h, unsigned shift) noexcept {
+    return std::uint32_t{1} << ((h >> shift) & 31);
+  }
+
+  // position among the entries or children marked in map
+  static unsigned index(std::uint32_t map, std::uint32_t bit) noexcept {
+    return __sp_popcount(map & (bit - 1));
+  }
+
+  const value_type *lookup(const K &key) const {
+    if (!_root)
+      return nullptr;
+    std::size_t h = _hash(key);
+    const node *n = _root.get();
+    for (unsigned shift = 0;; shift += bits) {
+      if (n->_collision) {
+        for (unsigned i = 0; i < n->_entries; ++i)
+          if (_equal(n->entries()[i].first, key))
+            return n->entries() + i;
+        return nullptr;
+      }
+      std::uint32_t bit = bitFor(h, shift);
+      if (n->_datamap & bit) {
+        const value_type *entry = n->entries() + index(n->_datamap, bit);
+        return _equal(entry->first, key) ? entry : nullptr;
+      }
+      if (!(n->_nodemap & bit))
+        return nullptr;
+      n = n->children()[index(n->_nodemap, bit)].get();
+    }
+  }
+
+  // moved when the node being replaced has no other owner
+  static void transfer(node *to, value_type &entry, bool move) {
+    if (move)
+      to->emplace(std::move(entry));
+    else
+      to->emplace(entry);
+  }
+
+  static void transfer(node_ptr &to, node_ptr &child, bool move) noexcept {
+    if (move)
+      to = std::move(child);
+    else
+      to = child;
+  }
+
+  static bool movable(const node_ptr &p) noexcept {
+    return nothrow_move && p.use_count() == 1;
+  }
+
+  // nodes shared with another version are copied before they change
+  static void makeUnique(node_ptr &p) {
+    if (p.use_count() == 1)
+      return;
+    node *n = p.get();
+    node_ptr copy = node::create(n->_children, n->_entries, n->_datamap,
+                                 n->_nodemap, n->_collision);
+    for (unsigned i = 0; i < n->_children; ++i)
+      copy->children()[i] = n->children()[i];
+    for (unsigned i = 0; i < n->_entries; ++i)
+      copy->emplace(n->entries()[i]);
+    p = std::move(copy);
+  }
+
+  V &writable(const K &key) {
+    std::size_t h = _hash(key);
+    node_ptr *ref = &_root;
+    for (unsigned shift = 0;; shift += bits) {
+      makeUnique(*ref);
+      node *n = ref->get();
+      if (n->_collision) {
+        for (unsigned i = 0;; ++i)
+          if (_equal(n->entries()[i].first, key))
+            return n->entries()[i].second;
+      }
+      std::uint32_t bit = bitFor(h, shift);
+      if (n->_datamap & bit)
+        return n->entries()[index(n->_datamap, bit)].second;
+      ref = n->children() + index(n->_nodemap, bit);
+    }
+  }
+
+  template <typename _Kp, typename _Mp>
+  bool put(_Kp &&key, _Mp &&value, bool assign) {
+    if (!_root)
+      _root = node::create(0, 0, 0, 0);
+    std::size_t h = _hash(key);
+    bool added = put(_root, 0, h, std::forward<_Kp>(key),
+                     std::forward<_Mp>(value), assign);
+    _size += added;
+    return added;
+  }
+
+  template <typename _Kp, typename _Mp>
+  bool put(node_ptr &ref, unsigned shift, std::size_t h, _Kp &&key,
+           _Mp &&value, bool assign) {
+    node *n = ref.get();
+    if (n->_collision) {
+      for (unsigned i = 0; i < n->_entries; ++i) {
+        if (_equal(n->entries()[i].first, key)) {
+          if (assign) {
+            makeUnique(ref);
+            ref->entries()[i].second = std::forward<_Mp>(value);
+          }
+          return false;
+        }
+      }
+      value_type entry(std::forward<_Kp>(key), std::forward<_Mp>(value));
+      bool move = movable(ref);
+      node_ptr r = node::create(0, n->_entries + 1, 0, 0, true);
+      for (unsigned i = 0; i < n->_entries; ++i)
+        transfer(r.get(), n->entries()[i], move);
+      r->emplace(std::move(entry));
+      ref = std::move(r);
+      return true;
+    }
+
+    std::uint32_t bit = bitFor(h, shift);
+    if (n->_datamap & bit) {
+      unsigned i = index(n->_datamap, bit);
+      if (_equal(n->entries()[i].first, key)) {
+        if (assign) {
+          makeUnique(ref);
+          ref->entries()[i].second = std::forward<_Mp>(value);
+        }
+        return false;
+      }
+      value_type entry(std::forward<_Kp>(key), std::forward<_Mp>(value));
+      splitEntry(ref, shift, bit, std::move(entry), h);
+      return true;
+    }
+
+    if (n->_nodemap & bit) {
+      makeUnique(ref);
+      return put(ref->children()[index(ref->_nodemap, bit)], shift + bits, h,
+                 std::forward<_Kp>(key), std::forward<_Mp>(value), assign);
+    }
+
+    value_type entry(std::forward<_Kp>(key), std::forward<_Mp>(value));
+    bool move = movable(ref);
+    unsigned at = index(n->_datamap, bit);
+    node_ptr r = node::create(n->_children, n->_entries + 1,
+                              n->_datamap | bit, n->_nodemap);
+    for (unsigned i = 0; i < n->_children; ++i)
+      transfer(r->children()[i], n->children()[i], move);
+    for (unsigned i = 0; i < n->_entries; ++i) {
+      if (i == at)
+        r->emplace(std::move(entry));
+      transfer(r.get(), n->entries()[i], move);
+    }
+    if (at == n->_entries)
+      r->emplace(std::move(entry));
+    ref = std::move(r);
+    return true;
+  }
+
+  // the entry of n at bit and entry share the fragment, both move into a
+  // new child. Every node is allocated before the old entry may be moved.
+  void splitEntry(node_ptr &ref, unsigned shift, std::uint32_t bit,
+                  value_type &&entry, std::size_t h) {
+    node *n = ref.get();
+    bool move = movable(ref);
+    unsigned at = index(n->_datamap, bit);
+    unsigned child_at = index(n->_nodemap, bit);
+    value_type &existing = n->entries()[at];
+
+    node_ptr r = node::create(n->_children + 1, n->_entries - 1,
+                              n->_datamap & ~bit, n->_nodemap | bit);
+    r->children()[child_at] = merge(shift + bits, existing,
+                                    _hash(existing.first), move,
+                                    std::move(entry), h);
+    for (unsigned i = 0, j = 0; i < n->_children; ++i, ++j) {
+      if (j == child_at)
+        ++j;
+      transfer(r->children()[j], n->children()[i], move);
+    }
+    for (unsigned i = 0; i < n->_entries; ++i)
+      if (i != at)
+        transfer(r.get(), n->entries()[i], move);
+    ref = std::move(r);
+  }
+
+  static node_ptr merge(unsigned shift, value_type &existing, std::size_t he,
+                        bool move, value_type &&entry, std::size_t h) {
+    if (shift >= hash_bits) {
+      node_ptr r = node::create(0, 2, 0, 0, true);
+      transfer(r.get(), existing, move);
+      r->emplace(std::move(entry));
+      return r;
+    }
+    std::uint32_t be = bitFor(he, shift);
+    std::uint32_t b = bitFor(h, shift);
+    if (be == b) {
+      node_ptr r = node::create(1, 0, 0, b);
+      r->children()[0] = merge(shift + bits, existing, he, move,
+                               std::move(entry), h);
+      return r;
+    }
+    node_ptr r = node::create(0, 2, be | b, 0);
+    if (be < b) {
+      transfer(r.get(), existing, move);
+      r->emplace(std::move(entry));
+    } else {
+      r->emplace(std::move(entry));
+      transfer(r.get(), existing, move);
+    }
+    return r;
+  }
+
+  // key is known to be below ref
+  void remove(node_ptr &ref, unsigned shift, std::size_t h, const K &key) {
+    node *n = ref.get();
+    bool move = movable(ref);
+    if (n->_collision) {
+      node_ptr r = node::create(0, n->_entries - 1, 0, 0, true);
+      for (unsigned i = 0; i < n->_entries; ++i)
+        if (!_equal(n->entries()[i].first, key))
+          transfer(r.get(), n->entries()[i], move);
+      ref = std::move(r);
+      return;
+    }
+
+    std::uint32_t bit = bitFor(h, shift);
+    if (n->_datamap & bit) {
+      unsigned at = index(n->_datamap, bit);
+      node_ptr r = node::create(n->_children, n->_entries - 1,
+                                n->_datamap & ~bit, n->_nodemap);
+      for (unsigned i = 0; i < n->_children; ++i)
+        transfer(r->children()[i], n->children()[i], move);
+      for (unsigned i = 0; i < n->_entries; ++i)
+        if (i != at)
+          transfer(r.get(), n->entries()[i], move);
+      ref = std::move(r);
+      return;
+    }
+
+    makeUnique(ref);
+    n = ref.get();
+    unsigned child_at = index(n->_nodemap, bit);
+    node_ptr &child = n->children()[child_at];
+    remove(child, shift + bits, h, key);
+    if (child->_children != 0 || child->_entries != 1)
+      return;
+
+    // a child left with one entry is replaced by the entry. n and the child
+    // are unique now, so their entries move unless moving may throw; the new
+    // node is allocated first, so a failed allocation leaves both intact
+    bool lift = movable(child);
+    value_type &lifted = child->entries()[0];
+    unsigned at = index(n->_datamap, bit);
+    node_ptr r = node::create(n->_children - 1, n->_entries + 1,
+                              n->_datamap | bit, n->_nodemap & ~bit);
+    for (unsigned i = 0, j = 0; i < n->_children; ++i)
+      if (i != child_at)
+        transfer(r->children()[j++], n->children()[i], nothrow_move);
+    for (unsigned i = 0; i < n->_entries; ++i) {
+      if (i == at)
+        transfer(r.get(), lifted, lift);
+      transfer(r.get(), n->entries()[i], nothrow_move);
+    }
+    if (at == n->_entries)
+      transfer(r.get(), lifted, lift);
+    ref = std::move(r);
+  }
+
+  node_ptr _root;
+  size_type _size{0};
+  Hash _hash;
+  KeyEqual _equal;
+};
+
+/// Forward iterator, keeps the path from the root to its entry
+template <typename K, typename V, typename Hash, typename KeyEqual>
+class single_thread_persistent_map<K, V, Hash, KeyEqual>::const_iterator {
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = typename single_thread_persistent_map::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const value_type *;
+  using reference = const value_type &;
+
+  const_iterator() noexcept = default;
+
+  reference operator*() const noexcept {
+    return _stack[_depth].n->entries()[_pos];
+  }
+
+  pointer operator->() const noexcept { return &**this; }
+
+  const_iterator &operator++() noexcept {
+    ++_pos;
+    settle();
+    return *this;
+  }
+
+  const_iterator operator++(int) noexcept {
+    auto it = *this;
+    ++*this;
+    return it;
+  }
+
+  friend bool operator==(const const_iterator &a,
+                         const const_iterator &b) noexcept {
+    return a._depth == b._depth &&
+           (a._depth < 0 ||
+            (a._stack[a._depth].n == b._stack[b._depth].n && a._pos == b._pos));
+  }
+
+  friend bool operator!=(const const_iterator &a,
+                         const const_iterator &b) noexcept {
+    return !(a == b);
+  }
+
+private:
+  friend class single_thread_persistent_map;
+
+  // a node, its entries come first, then the children from child on
+  struct frame {
+    const node *n;
+    unsigned child;
+  };
+
+  explicit const_iterator(const node *root) noexcept {
+    if (!root)
+      return;
+    push(root, 0);
+    settle();
+  }
+
+  void push(const node *n, unsigned child) noexcept {
+    _stack[++_depth] = frame{n, child};
+  }
+
+  const_iterator &at(const node *n, unsigned pos) noexcept {
+    push(n, 0);
+    _pos = pos;
+    return *this;
+  }
+
+  // moves to the next entry from _pos of the top node on
+  void settle() noexcept {
+    while (_depth >= 0) {
+      frame &f = _stack[_depth];
+      if (_pos < f.n->_entries)
+        return;
+      if (f.child < f.n->_children) {
+        push(f.n->children()[f.child++].get(), 0);
+        _pos = 0;
+        continue;
+      }
+      if (--_depth >= 0)
+        _pos = _stack[_depth].n->_entries;
+    }
+  }
+
+  frame _stack[max_depth]{};
+  int _depth{-1};
+  unsigned _pos{0};
+};
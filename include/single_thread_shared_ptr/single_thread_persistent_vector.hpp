@@ -0,0 +1,476 @@
+#pragma once
+
+#include <single_thread_shared_ptr/single_thread_intrusive_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+// Node of a single_thread_persistent_vector, a leaf holding up to width
+// elements or an inner node holding up to width children, stored behind
+// the header in the node's one allocation, which is sized for the kind of
+// node. A copy shares the children of the original, so copying the path to
+// an element copies O(log n) nodes.
+template <typename _Tp> struct single_thread_persistent_vector_node {
+  using ptr = single_thread_intrusive_ptr<single_thread_persistent_vector_node>;
+
+  static constexpr unsigned bits = 5;
+  static constexpr unsigned width = 1u << bits;
+
+  static ptr create(bool leaf) {
+    void *memory = ::operator new(
+        slotsOffset() + width * (leaf ? sizeof(_Tp) : sizeof(ptr)),
+        std::align_val_t{alignment()});
+    auto *n = ::new (memory) single_thread_persistent_vector_node;
+    n->_leaf = leaf;
+    return ptr(n);
+  }
+
+  // a node which failed to fill is destroyed with the slots it got
+  static ptr copy(const single_thread_persistent_vector_node &rhs) {
+    ptr n = create(rhs._leaf);
+    if (rhs._leaf)
+      while (n->_size < rhs._size)
+        n->emplace(rhs.values()[n->_size]);
+    else
+      while (n->_size < rhs._size)
+        n->push(rhs.children()[n->_size]);
+    return n;
+  }
+
+  static void destroy(single_thread_persistent_vector_node *n) noexcept {
+    n->clear();
+    n->~single_thread_persistent_vector_node();
+    ::operator delete(n, std::align_val_t{alignment()});
+  }
+
+  template <typename... _Args> void emplace(_Args &&...__args) {
+    ::new (static_cast<void *>(values() + _size))
+        _Tp(std::forward<_Args>(__args)...);
+    ++_size;
+  }
+
+  void push(ptr child) noexcept {
+    ::new (static_cast<void *>(children() + _size)) ptr(std::move(child));
+    ++_size;
+  }
+
+  void pop() noexcept {
+    --_size;
+    if (_leaf)
+      values()[_size].~_Tp();
+    else
+      children()[_size].~ptr();
+  }
+
+  void clear() noexcept {
+    while (_size)
+      pop();
+  }
+
+  _Tp *values() noexcept {
+    return reinterpret_cast<_Tp *>(reinterpret_cast<char *>(this) +
+                                   slotsOffset());
+  }
+
+  const _Tp *values() const noexcept {
+    return const_cast<single_thread_persistent_vector_node *>(this)->values();
+  }
+
+  ptr *children() noexcept {
+    return reinterpret_cast<ptr *>(reinterpret_cast<char *>(this) +
+                                   slotsOffset());
+  }
+
+  const ptr *children() const noexcept {
+    return const_cast<single_thread_persistent_vector_node *>(this)
+        ->children();
+  }
+
+  static constexpr std::size_t alignment() {
+    return std::max({alignof(single_thread_persistent_vector_node),
+                     alignof(ptr), alignof(_Tp)});
+  }
+
+  static constexpr std::size_t slotsOffset() {
+    return (sizeof(single_thread_persistent_vector_node) + alignment() - 1) /
+           alignment() * alignment();
+  }
+
+  unsigned _ref_count{0};
+  unsigned _size{0};
+  bool _leaf{false};
+};
+
+template <typename _Tp>
+struct single_thread_intrusive_ptr_traits<
+    single_thread_persistent_vector_node<_Tp>> {
+  using node = single_thread_persistent_vector_node<_Tp>;
+
+  static void add_ref(node *p) noexcept { ++p->_ref_count; }
+  static void release(node *p) noexcept {
+    if (--p->_ref_count == 0)
+      node::destroy(p);
+  }
+  static long use_count(const node *p) noexcept { return p->_ref_count; }
+};
+
+/// NON THREAD SAFE persistent vector (bit partitioned trie of width 32 with
+/// a tail, after Clojure's PersistentVector). Copies are O(1) and share all
+/// nodes; a change copies only the nodes on its path which are shared with
+/// another version, which the node counts tell. A batch of changes to one
+/// copy therefore copies each path once and then updates in place, and a
+/// vector nobody shares never copies a node. Elements are read only through
+/// the vector, set() and update() replace them.
+template <typename T> class single_thread_persistent_vector {
+  using node = single_thread_persistent_vector_node<T>;
+  using node_ptr = typename node::ptr;
+
+  static constexpr unsigned bits = node::bits;
+  static constexpr std::size_t mask = node::width - 1;
+
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = const T &;
+  using const_reference = const T &;
+
+  class const_iterator;
+  using iterator = const_iterator;
+
+  single_thread_persistent_vector() noexcept = default;
+
+  single_thread_persistent_vector(const single_thread_persistent_vector &) =
+      default;
+
+  // a moved from vector is empty
+  single_thread_persistent_vector(
+      single_thread_persistent_vector &&rhs) noexcept {
+    swap(rhs);
+  }
+
+  single_thread_persistent_vector &
+  operator=(const single_thread_persistent_vector &) = default;
+
+  single_thread_persistent_vector &
+  operator=(single_thread_persistent_vector &&rhs) noexcept {
+    single_thread_persistent_vector(std::move(rhs)).swap(*this);
+    return *this;
+  }
+
+  single_thread_persistent_vector(std::initializer_list<T> values) {
+    for (const auto &v : values)
+      push_back(v);
+  }
+
+  template <typename _InputIt>
+  single_thread_persistent_vector(_InputIt first, _InputIt last) {
+    for (; first != last; ++first)
+      push_back(*first);
+  }
+
+  size_type size() const noexcept { return _size; }
+  bool empty() const noexcept { return _size == 0; }
+
+  const T &operator[](size_type i) const noexcept {
+    assert(i < _size);
+    return leafFor(i)->values()[i & mask];
+  }
+
+  const T &at(size_type i) const {
+    if (i >= _size)
+      throw std::out_of_range("single_thread_persistent_vector::at");
+    return (*this)[i];
+  }
+
+  const T &front() const noexcept { return (*this)[0]; }
+  const T &back() const noexcept { return (*this)[_size - 1]; }
+
+  const_iterator begin() const noexcept { return const_iterator(this, 0); }
+  const_iterator end() const noexcept { return const_iterator(this, _size); }
+
+  template <typename... _Args> const T &emplace_back(_Args &&...__args) {
+    if (_size - tailOffset() < node::width) {
+      if (!_tail)
+        _tail = node::create(true);
+      else
+        makeUnique(_tail);
+      _tail->emplace(std::forward<_Args>(__args)...);
+      ++_size;
+      return _tail->values()[_tail->_size - 1];
+    }
+
+    // the full tail moves into the tree, the element starts a new one
+    node_ptr leaf = node::create(true);
+    leaf->emplace(std::forward<_Args>(__args)...);
+    if (!_root) {
+      _root = newPath(_shift, _tail);
+    } else if ((_size >> bits) > (size_type{1} << _shift)) {
+      node_ptr root = node::create(false);
+      root->push(_root);
+      root->push(newPath(_shift, _tail));
+      _root = std::move(root);
+      _shift += bits;
+    } else {
+      makeUnique(_root);
+      pushTail(_shift, _root.get(), _tail);
+    }
+    _tail = std::move(leaf);
+    ++_size;
+    return _tail->values()[0];
+  }
+
+  void push_back(const T &value) { emplace_back(value); }
+  void push_back(T &&value) { emplace_back(std::move(value)); }
+
+  /// Replace the element at i
+  template <typename _Up> void set(size_type i, _Up &&value) {
+    writable(i) = std::forward<_Up>(value);
+  }
+
+  /// f(T &) with the element at i, returns what f returns
+  template <typename _Fn> decltype(auto) update(size_type i, _Fn &&f) {
+    return std::invoke(std::forward<_Fn>(f), writable(i));
+  }
+
+  void pop_back() {
+    assert(_size > 0);
+    if (_size == 1) {
+      clear();
+      return;
+    }
+    if (_size - tailOffset() > 1) {
+      makeUnique(_tail);
+      _tail->pop();
+      --_size;
+      return;
+    }
+
+    // the last leaf of the tree becomes the tail
+    node_ptr leaf(leafFor(_size - 2));
+    makeUnique(_root);
+    if (popTail(_shift, _root.get())) {
+      _root.reset();
+      _shift = bits;
+    } else if (_shift > bits && _root->_size == 1) {
+      node_ptr child = _root->children()[0];
+      _root = std::move(child);
+      _shift -= bits;
+    }
+    _tail = std::move(leaf);
+    --_size;
+  }
+
+  void clear() noexcept {
+    _root.reset();
+    _tail.reset();
+    _size = 0;
+    _shift = bits;
+  }
+
+  void swap(single_thread_persistent_vector &rhs) noexcept {
+    _root.swap(rhs._root);
+    _tail.swap(rhs._tail);
+    std::swap(_size, rhs._size);
+    std::swap(_shift, rhs._shift);
+  }
+
+private:
+  // index of the first element in the tail
+  size_type tailOffset() const noexcept {
+    return _size < node::width ? 0 : ((_size - 1) >> bits) << bits;
+  }
+
+  node *leafFor(size_type i) const noexcept {
+    if (i >= tailOffset())
+      return _tail.get();
+    node *n = _root.get();
+    for (unsigned level = _shift; level > 0; level -= bits)
+      n = n->children()[(i >> level) & mask].get();
+    return n;
+  }
+
+  // nodes shared with another version are copied before they change
+  static void makeUnique(node_ptr &p) {
+    if (p.use_count() != 1)
+      p = node::copy(*p);
+  }
+
+  T &writable(size_type i) {
+    assert(i < _size);
+    if (i >= tailOffset()) {
+      makeUnique(_tail);
+      return _tail->values()[i & mask];
+    }
+    makeUnique(_root);
+    node *n = _root.get();
+    for (unsigned level = _shift; level > 0; level -= bits) {
+      auto &child = n->children()[(i >> level) & mask];
+      makeUnique(child);
+      n = child.get();
+    }
+    return n->values()[i & mask];
+  }
+
+  // chain of single child inner nodes from level down to leaf
+  static node_ptr newPath(unsigned level, node_ptr leaf) {
+    if (level == 0)
+      return leaf;
+    node_ptr n = node::create(false);
+    n->push(newPath(level - bits, std::move(leaf)));
+    return n;
+  }
+
+  // appends the full tail below parent, which only this vector owns
+  void pushTail(unsigned level, node *parent, node_ptr tail) {
+    size_type sub = ((_size - 1) >> level) & mask;
+    if (level == bits) {
+      parent->push(std::move(tail));
+    } else if (sub < parent->_size) {
+      auto &child = parent->children()[sub];
+      makeUnique(child);
+      pushTail(level - bits, child.get(), std::move(tail));
+    } else {
+      parent->push(newPath(level - bits, std::move(tail)));
+    }
+  }
+
+  // removes the last leaf below n, which only this vector owns, returns
+  // true when n is left empty
+  bool popTail(unsigned level, node *n) {
+    assert((((_size - 2) >> level) & mask) == n->_size - 1);
+    if (level > bits) {
+      auto &child = n->children()[n->_size - 1];
+      makeUnique(child);
+      if (popTail(level - bits, child.get()))
+        n->pop();
+    } else {
+      n->pop();
+    }
+    return n->_size == 0;
+  }
+
+  node_ptr _root;
+  node_ptr _tail;
+  size_type _size{0};
+  unsigned _shift{bits};
+};
+
+/// Random access iterator, keeps the leaf of its position
+template <typename T>
+class single_thread_persistent_vector<T>::const_iterator {
+public:
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = T;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const T *;
+  using reference = const T &;
+
+  const_iterator() noexcept = default;
+
+  reference operator*() const noexcept { return _leaf[_index & mask]; }
+  pointer operator->() const noexcept { return _leaf + (_index & mask); }
+  reference operator[](difference_type n) const noexcept {
+    return (*_vector)[_index + n];
+  }
+
+  const_iterator &operator++() noexcept { return *this += 1; }
+  const_iterator &operator--() noexcept { return *this -= 1; }
+
+  const_iterator operator++(int) noexcept {
+    auto it = *this;
+    ++*this;
+    return it;
+  }
+
+  const_iterator operator--(int) noexcept {
+    auto it = *this;
+    --*this;
+    return it;
+  }
+
+  const_iterator &operator+=(difference_type n) noexcept {
+    _index += n;
+    load();
+    return *this;
+  }
+
+  const_iterator &operator-=(difference_type n) noexcept {
+    return *this += -n;
+  }
+
+  friend const_iterator operator+(const_iterator it,
+                                  difference_type n) noexcept {
+    return it += n;
+  }
+
+  friend const_iterator operator+(difference_type n,
+                                  const_iterator it) noexcept {
+    return it += n;
+  }
+
+  friend const_iterator operator-(const_iterator it,
+                                  difference_type n) noexcept {
+    return it -= n;
+  }
+
+  friend difference_type operator-(const const_iterator &a,
+                                   const const_iterator &b) noexcept {
+    return difference_type(a._index) - difference_type(b._index);
+  }
+
+  friend bool operator==(const const_iterator &a,
+                         const const_iterator &b) noexcept {
+    return a._index == b._index;
+  }
+  friend bool operator!=(const const_iterator &a,
+                         const const_iterator &b) noexcept {
+    return a._index != b._index;
+  }
+  friend bool operator<(const const_iterator &a,
+                        const const_iterator &b) noexcept {
+    return a._index < b._index;
+  }
+  friend bool operator>(const const_iterator &a,
+                        const const_iterator &b) noexcept {
+    return b < a;
+  }
+  friend bool operator<=(const const_iterator &a,
+                         const const_iterator &b) noexcept {
+    return !(b < a);
+  }
+  friend bool operator>=(const const_iterator &a,
+                         const const_iterator &b) noexcept {
+    return !(a < b);
+  }
+
+private:
+  friend class single_thread_persistent_vector;
+
+  const_iterator(const single_thread_persistent_vector *vector,
+                 size_type index) noexcept
+      : _vector{vector}, _index{index} {
+    load();
+  }
+
+  // leaves start at multiples of the width, so 1 never matches one
+  void load() noexcept {
+    size_type base = _index & ~mask;
+    if (_index < _vector->_size && base != _base) {
+      _leaf = _vector->leafFor(_index)->values();
+      _base = base;
+    }
+  }
+
+  const single_thread_persistent_vector *_vector{nullptr};
+  size_type _index{0};
+  size_type _base{1};
+  const T *_leaf{nullptr};
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/// True when moving an object to a new address and ending the lifetime of
+/// the source is equivalent to copying its bytes. Holds for trivially
+/// copyable types and for types declaring a trivially_relocatable member
+/// type, like the pointers of this library; specialize it for others.
+template <typename _Tp, typename = void>
+struct single_thread_is_trivially_relocatable
+    : std::is_trivially_copyable<_Tp> {};
+
+template <typename _Tp>
+struct single_thread_is_trivially_relocatable<
+    _Tp, std::void_t<typename _Tp::trivially_relocatable>>
+    : _Tp::trivially_relocatable {};
+
+template <typename _Tp>
+inline constexpr bool single_thread_is_trivially_relocatable_v =
+    single_thread_is_trivially_relocatable<_Tp>::value;
+
+/// Minimal vector which grows and erases with memcpy / memmove when its
+/// elements are trivially relocatable, instead of a move constructor and a
+/// destructor call per element. Other types are moved one by one, so they
+/// must not throw while being moved.
+template <typename T> class single_thread_relocating_vector {
+  static_assert(single_thread_is_trivially_relocatable_v<T> ||
+                    (std::is_nothrow_move_constructible_v<T> &&
+                     std::is_nothrow_move_assignable_v<T>),
+                "elements are relocated without a way to report errors");
+
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T &;
+  using const_reference = const T &;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using iterator = T *;
+  using const_iterator = const T *;
+
+  constexpr single_thread_relocating_vector() noexcept = default;
+
+  // delegating first, so the elements built before one throws are destroyed
+  single_thread_relocating_vector(std::initializer_list<T> init)
+      : single_thread_relocating_vector() {
+    reserve(init.size());
+    for (const auto &value : init)
+      push_back(value);
+  }
+
+  single_thread_relocating_vector(const single_thread_relocating_vector &rhs)
+      : single_thread_relocating_vector() {
+    reserve(rhs.size());
+    for (const auto &value : rhs)
+      push_back(value);
+  }
+
+  single_thread_relocating_vector(single_thread_relocating_vector &&rhs) noexcept
+      : _data{std::exchange(rhs._data, nullptr)},
+        _size{std::exchange(rhs._size, 0)},
+        _capacity{std::exchange(rhs._capacity, 0)} {}
+
+  single_thread_relocating_vector &
+  operator=(const single_thread_relocating_vector &rhs) {
+    single_thread_relocating_vector(rhs).swap(*this);
+    return *this;
+  }
+
+  single_thread_relocating_vector &
+  operator=(single_thread_relocating_vector &&rhs) noexcept {
+    single_thread_relocating_vector(std::move(rhs)).swap(*this);
+    return *this;
+  }
+
+  ~single_thread_relocating_vector() noexcept {
+    clear();
+    deallocate(_data, _capacity);
+  }
+
+  iterator begin() noexcept { return _data; }
+  const_iterator begin() const noexcept { return _data; }
+  iterator end() noexcept { return _data + _size; }
+  const_iterator end() const noexcept { return _data + _size; }
+
+  T *data() noexcept { return _data; }
+  const T *data() const noexcept { return _data; }
+
+  size_type size() const noexcept { return _size; }
+  size_type capacity() const noexcept { return _capacity; }
+  bool empty() const noexcept { return _size == 0; }
+
+  reference operator[](size_type i) noexcept {
+    assert(i < _size);
+    return _data[i];
+  }
+
+  const_reference operator[](size_type i) const noexcept {
+    assert(i < _size);
+    return _data[i];
+  }
+
+  reference front() noexcept { return (*this)[0]; }
+  const_reference front() const noexcept { return (*this)[0]; }
+  reference back() noexcept { return (*this)[_size - 1]; }
+  const_reference back() const noexcept { return (*this)[_size - 1]; }
+
+  void reserve(size_type capacity) {
+    if (capacity > _capacity)
+      reallocate(capacity);
+  }
+
+  void shrink_to_fit() {
+    if (_size < _capacity)
+      reallocate(_size);
+  }
+
+  void push_back(const T &value) { emplace_back(value); }
+
+  void push_back(T &&value) { emplace_back(std::move(value)); }
+
+  template <typename... _Args> reference emplace_back(_Args &&...__args) {
+    // counted only once it is built
+    if (_size < _capacity) {
+      ::new (static_cast<void *>(_data + _size))
+          T(std::forward<_Args>(__args)...);
+      return _data[_size++];
+    }
+
+    // the arguments may refer to an element, so the new element is built
+    // before the old ones are relocated
+    size_type capacity = _capacity ? 2 * _capacity : 4;
+    T *data = allocate(capacity);
+    try {
+      ::new (static_cast<void *>(data + _size))
+          T(std::forward<_Args>(__args)...);
+    } catch (...) {
+      deallocate(data, capacity);
+      throw;
+    }
+    relocate(_data, _size, data);
+    deallocate(_data, _capacity);
+    _data = data;
+    _capacity = capacity;
+    return _data[_size++];
+  }
+
+  void pop_back() noexcept {
+    assert(_size > 0);
+    _data[--_size].~T();
+  }
+
+  iterator erase(const_iterator pos) noexcept { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) noexcept {
+    auto *begin = const_cast<T *>(first);
+    auto *end = const_cast<T *>(last);
+    assert(_data <= begin && begin <= end && end <= _data + _size);
+    if (begin == end)
+      return begin;
+
+    size_type tail = static_cast<size_type>(_data + _size - end);
+    if constexpr (single_thread_is_trivially_relocatable_v<T>) {
+      std::destroy(begin, end);
+      std::memmove(static_cast<void *>(begin), static_cast<const void *>(end),
+                   tail * sizeof(T));
+    } else {
+      std::move(end, end + tail, begin);
+      std::destroy(begin + tail, _data + _size);
+    }
+    _size -= static_cast<size_type>(end - begin);
+    return begin;
+  }
+
+  void clear() noexcept {
+    std::destroy(_data, _data + _size);
+    _size = 0;
+  }
+
+  void swap(single_thread_relocating_vector &rhs) noexcept {
+    std::swap(_data, rhs._data);
+    std::swap(_size, rhs._size);
+    std::swap(_capacity, rhs._capacity);
+  }
+
+private:
+  static T *allocate(size_type capacity) {
+    return std::allocator<T>().allocate(capacity);
+  }
+
+  static void deallocate(T *data, size_type capacity) noexcept {
+    if (data)
+      std::allocator<T>().deallocate(data, capacity);
+  }
+
+  // moves n elements to uninitialized dest, the source is left raw memory
+  static void relocate(T *first, size_type n, T *dest) noexcept {
+    if constexpr (single_thread_is_trivially_relocatable_v<T>) {
+      if (n)
+        std::memcpy(static_cast<void *>(dest), static_cast<const void *>(first),
+                    n * sizeof(T));
+    } else {
+      for (size_type i = 0; i < n; ++i) {
+        ::new (static_cast<void *>(dest + i)) T(std::move(first[i]));
+        first[i].~T();
+      }
+    }
+  }
+
+  void reallocate(size_type capacity) {
+    T *data = capacity ? allocate(capacity) : nullptr;
+    relocate(_data, _size, data);
+    deallocate(_data, _capacity);
+    _data = data;
+    _capacity = capacity;
+  }
+
+  T *_data{nullptr};
+  size_type _size{0};
+  size_type _capacity{0};
+};
+
+/// Vector of single_thread_shared_ptr which relocates its elements bitwise
+template <typename T>
+using single_thread_shared_vector =
+    single_thread_relocating_vector<single_thread_shared_ptr<T>>;
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/// Counts of a single_thread_shared_pool since its creation or the last
+/// reset_stats()
+struct single_thread_shared_pool_stats {
+  std::uint64_t hits{0};      // objects handed out from recycled blocks
+  std::uint64_t misses{0};    // objects which needed a new block
+  std::uint64_t recycled{0};  // blocks returned to the free list
+  std::uint64_t discarded{0}; // blocks deleted: free list full or pool gone
+};
+
+template <typename T> class single_thread_shared_pool;
+
+// Object and its counter, recycled by a pool instead of being freed. _live
+// tells whether a block on the free list still holds a (reset) object.
+template <typename _Tp>
+struct single_thread_shared_pool_block : single_thread_shared_ptr_control_block {
+  using object_type = std::remove_cv_t<_Tp>;
+  using pool_state = typename single_thread_shared_pool<_Tp>::State;
+
+  explicit single_thread_shared_pool_block(pool_state *pool) noexcept
+      : single_thread_shared_ptr_control_block{1, 1, &manage}, _pool{pool} {}
+
+  ~single_thread_shared_pool_block() {}
+
+  _Tp *ptr() noexcept { return std::addressof(_object); }
+
+  // the block is handed out again
+  void rearm() noexcept {
+    static_cast<single_thread_shared_ptr_control_block &>(*this) =
+        single_thread_shared_ptr_control_block{1, 1, &manage};
+  }
+
+  void destroyObject() noexcept {
+    if (std::exchange(_live, false))
+      _object.~object_type();
+  }
+
+  static void manage(single_thread_shared_ptr_control_block *cb,
+                     single_thread_shared_ptr_block_op op) noexcept {
+    auto *self = static_cast<single_thread_shared_pool_block *>(cb);
+    if (op == single_thread_shared_ptr_block_op::dispose)
+      self->_pool->dispose(self);
+    else
+      self->_pool->recycle(self);
+  }
+
+  union {
+    object_type _object;
+  };
+  pool_state *_pool;
+  single_thread_shared_pool_block *_next{nullptr};
+  bool _live{false};
+};
+
+/// NON THREAD SAFE pool handing out single_thread_shared_ptr<T>. When the
+/// last owner (and weak pointer) of an object is gone its block, holding the
+/// object and the counter, goes back to a free list of at most capacity
+/// blocks instead of being freed. By default the object is destroyed then
+/// and the next make() constructs into the recycled storage; a pool created
+/// with a reset function keeps released objects alive, calls reset(object)
+/// instead (it must not throw) and acquire() hands them out as they are.
+/// Objects may outlive the pool, their blocks are freed when released.
+template <typename T> class single_thread_shared_pool {
+  static_assert(!std::is_array_v<T>, "arrays are not supported");
+
+  using block = single_thread_shared_pool_block<T>;
+  using object_type = std::remove_cv_t<T>;
+
+public:
+  using element_type = T;
+  using reset_fn = std::function<void(T &)>;
+
+  explicit single_thread_shared_pool(std::size_t capacity = 1024)
+      : _state{new State{capacity, nullptr}} {}
+
+  single_thread_shared_pool(std::size_t capacity, reset_fn reset)
+      : _state{new State{capacity, std::move(reset)}} {}
+
+  single_thread_shared_pool(const single_thread_shared_pool &) = delete;
+  single_thread_shared_pool &
+  operator=(const single_thread_shared_pool &) = delete;
+
+  ~single_thread_shared_pool() noexcept {
+    _state->trim(0);
+    _state->_closed = true;
+    if (_state->_outstanding == 0)
+      delete _state;
+  }
+
+  /// New object constructed from __args, in a recycled block when there is
+  /// one (a kept object is destroyed first)
+  template <typename... _Args>
+  single_thread_shared_ptr<T> make(_Args &&...__args) {
+    bool hit;
+    block *b = _state->pop(hit);
+    b->destroyObject();
+    try {
+      ::new (static_cast<void *>(std::addressof(b->_object)))
+          object_type(std::forward<_Args>(__args)...);
+    } catch (...) {
+      _state->giveBack(b);
+      throw;
+    }
+    b->_live = true;
+    return _state->handOut(b, hit);
+  }
+
+  /// A kept object as reset() left it, or a value initialized new one
+  single_thread_shared_ptr<T> acquire() {
+    bool hit;
+    block *b = _state->pop(hit);
+    if (!b->_live) {
+      try {
+        ::new (static_cast<void *>(std::addressof(b->_object))) object_type();
+      } catch (...) {
+        _state->giveBack(b);
+        throw;
+      }
+      b->_live = true;
+    }
+    return _state->handOut(b, hit);
+  }
+
+  /// Allocate blocks up to count free ones (limited by the capacity)
+  void reserve(std::size_t count) {
+    count = std::min(count, _state->_capacity);
+    while (_state->_size < count)
+      _state->push(new block(_state));
+  }
+
+  /// Free blocks until at most keep are left
+  void trim(std::size_t keep = 0) noexcept { _state->trim(keep); }
+
+  std::size_t capacity() const noexcept { return _state->_capacity; }
+
+  /// Change the capacity, dropping free blocks above it
+  void set_capacity(std::size_t capacity) noexcept {
+    _state->_capacity = capacity;
+    _state->trim(capacity);
+  }
+
+  /// Blocks waiting on the free list
+  std::size_t size() const noexcept { return _state->_size; }
+
+  /// Blocks handed out and not returned yet
+  std::size_t outstanding() const noexcept { return _state->_outstanding; }
+
+  single_thread_shared_pool_stats stats() const noexcept {
+    return _state->_stats;
+  }
+
+  void reset_stats() noexcept { _state->_stats = {}; }
+
+  friend struct single_thread_shared_pool_block<T>;
+
+private:
+  // Shared by the pool and its blocks, outlives the pool until the last
+  // block handed out is returned
+  struct State {
+    State(std::size_t capacity, reset_fn reset)
+        : _capacity{capacity}, _reset{std::move(reset)} {}
+
+    // a free block, or a new one (hit is false) when there is none; a block
+    // is only counted once its object is handed out
+    block *pop(bool &hit) {
+      hit = _free != nullptr;
+      if (!hit)
+        return new block(this);
+      --_size;
+      return std::exchange(_free, _free->_next);
+    }
+
+    void push(block *b) noexcept {
+      b->_next = std::exchange(_free, b);
+      ++_size;
+    }
+
+    // block whose object failed to construct, kept while there is room
+    void giveBack(block *b) noexcept {
+      if (_size < _capacity)
+        push(b);
+      else
+        delete b;
+    }
+
+    single_thread_shared_ptr<T> handOut(block *b, bool hit) noexcept {
+      ++(hit ? _stats.hits : _stats.misses);
+      b->rearm();
+      ++_outstanding;
+      SINGLE_THREAD_SHARED_PTR_RECORD(onCounterAllocation);
+      return single_thread_shared_ptr_factory::adopt<T>(b->ptr(), b);
+    }
+
+    // last owner is gone; a kept object forgets its weak reference to
+    // itself first, which would keep the block from being recycled
+    void dispose(block *b) noexcept {
+      if (_reset && !_closed) {
+        single_thread_shared_ptr_factory::forgetOwners(b->_object);
+        _reset(b->_object);
+      } else {
+        b->destroyObject();
+      }
+    }
+
+    // last weak reference is gone too
+    void recycle(block *b) noexcept {
+      --_outstanding;
+      if (!_closed && _size < _capacity) {
+        ++_stats.recycled;
+        push(b);
+        return;
+      }
+      ++_stats.discarded;
+      b->destroyObject();
+      delete b;
+      if (_closed && _outstanding == 0)
+        delete this;
+    }
+
+    void trim(std::size_t keep) noexcept {
+      while (_size > keep) {
+        block *b = std::exchange(_free, _free->_next);
+        --_size;
+        b->destroyObject();
+        delete b;
+      }
+    }
+
+    std::size_t _capacity;
+    reset_fn _reset;
+    block *_free{nullptr};
+    std::size_t _size{0};
+    std::size_t _outstanding{0};
+    bool _closed{false};
+    single_thread_shared_pool_stats _stats;
+  };
+
+  State *_state;
+};
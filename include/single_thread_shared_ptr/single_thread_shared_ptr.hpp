@@ -1,13 +1,67 @@
+#pragma once
+
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
 
+#if defined(SINGLE_THREAD_SHARED_PTR_THREAD_CHECK)
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#endif
+
+#if defined(_MSC_VER)
+#define SINGLE_THREAD_SHARED_PTR_NOINLINE __declspec(noinline)
+#else
+#define SINGLE_THREAD_SHARED_PTR_NOINLINE __attribute__((noinline))
+#endif
+
+// Facts the optimizer cannot prove on its own, checked in debug builds
+#if !defined(NDEBUG)
+#define SINGLE_THREAD_SHARED_PTR_ASSUME(condition) assert(condition)
+#elif defined(_MSC_VER)
+#define SINGLE_THREAD_SHARED_PTR_ASSUME(condition) __assume(condition)
+#else
+#define SINGLE_THREAD_SHARED_PTR_ASSUME(condition)                             \
+  do {                                                                         \
+    if (!(condition))                                                          \
+      __builtin_unreachable();                                                 \
+  } while (false)
+#endif
+
+// When T is U[N], Y(*)[N] shall be convertible to T*;
+template <typename _Up, std::size_t _Nm, typename _Yp>
+struct __sp_is_constructible_arrN
+    : std::is_convertible<_Yp (*)[_Nm], _Up (*)[_Nm]>::type {};
+
+// when T is U[], Y(*)[] shall be convertible to T*;
+template <typename _Up, typename _Yp>
+struct __sp_is_constructible_arr
+    : std::is_convertible<_Yp (*)[], _Up (*)[]>::type {};
+
 // otherwise, Y* shall be convertible to T*.
 template <typename _Tp, typename _Yp>
 struct __sp_is_constructible : std::is_convertible<_Yp *, _Tp *>::type {};
 
+template <typename _Up, typename _Yp>
+struct __sp_is_constructible<_Up[], _Yp>
+    : __sp_is_constructible_arr<_Up, _Yp> {};
+
+template <typename _Up, std::size_t _Nm, typename _Yp>
+struct __sp_is_constructible<_Up[_Nm], _Yp>
+    : __sp_is_constructible_arrN<_Up, _Nm, _Yp> {};
+
 // A pointer type Y* is said to be compatible with a pointer type T* when
 // either Y* is convertible to T* or Y is U[N] and T is U cv [].
 template <typename _Yp_ptr, typename _Tp_ptr>
@@ -17,23 +71,621 @@ template <typename _Yp, typename _Tp>
 struct __sp_compatible_with<_Yp *, _Tp *>
     : std::is_convertible<_Yp *, _Tp *>::type {};
 
+template <typename _Up, std::size_t _Nm>
+struct __sp_compatible_with<_Up (*)[_Nm], _Up (*)[]> : std::true_type {};
+
+template <typename _Up, std::size_t _Nm>
+struct __sp_compatible_with<_Up (*)[_Nm], const _Up (*)[]> : std::true_type {};
+
+template <typename _Up, std::size_t _Nm>
+struct __sp_compatible_with<_Up (*)[_Nm], volatile _Up (*)[]>
+    : std::true_type {};
+
+template <typename _Up, std::size_t _Nm>
+struct __sp_compatible_with<_Up (*)[_Nm], const volatile _Up (*)[]>
+    : std::true_type {};
+
+/// Reference counting events of the calling thread. Recorded only when
+/// SINGLE_THREAD_SHARED_PTR_STATS is defined (for every translation unit),
+/// otherwise the counters stay zero and no code is generated for them.
+/// Counters created on one thread and released on another are accounted to
+/// each thread separately.
+struct single_thread_shared_ptr_stats {
+  std::uint64_t promotions{0};          // sole owner counters moved to heap
+  std::uint64_t reclaims{0};            // heap counters of a lone survivor
+                                        // moved back inline
+  std::uint64_t counter_allocations{0}; // all heap counters, promotions too
+  std::uint64_t counter_frees{0};       // heap counters released
+  std::uint64_t object_deletes{0};      // objects destroyed by the last owner
+  std::int64_t live_counters{0};        // allocations - frees
+  std::int64_t peak_live_counters{0};
+};
+
+class single_thread_shared_ptr_statistics {
+public:
+#if defined(SINGLE_THREAD_SHARED_PTR_STATS)
+  static constexpr bool enabled = true;
+#else
+  static constexpr bool enabled = false;
+#endif
+
+  static single_thread_shared_ptr_stats get() noexcept { return local(); }
+
+  static void reset() noexcept { local() = single_thread_shared_ptr_stats{}; }
+
+  static void onPromotion() noexcept {
+    ++local().promotions;
+    onCounterAllocation();
+  }
+
+  static void onCounterAllocation() noexcept {
+    auto &stats = local();
+    ++stats.counter_allocations;
+    if (++stats.live_counters > stats.peak_live_counters)
+      stats.peak_live_counters = stats.live_counters;
+  }
+
+  static void onCounterFree() noexcept {
+    auto &stats = local();
+    ++stats.counter_frees;
+    --stats.live_counters;
+  }
+
+  static void onReclaim() noexcept {
+    ++local().reclaims;
+    onCounterFree();
+  }
+
+  static void onObjectDelete() noexcept { ++local().object_deletes; }
+
+private:
+  static single_thread_shared_ptr_stats &local() noexcept {
+    thread_local single_thread_shared_ptr_stats stats;
+    return stats;
+  }
+};
+
+#if defined(SINGLE_THREAD_SHARED_PTR_STATS)
+#define SINGLE_THREAD_SHARED_PTR_RECORD(event)                                 \
+  single_thread_shared_ptr_statistics::event()
+#else
+#define SINGLE_THREAD_SHARED_PTR_RECORD(event) ((void)0)
+#endif
+
+enum class single_thread_shared_ptr_block_op {
+  dispose, // destroy the managed object
+  destroy, // release the block itself
+#if defined(SINGLE_THREAD_SHARED_PTR_CYCLE_COLLECTOR)
+  possible_root // an owner is gone but others are left, only sent to
+                // blocks which set _collectible
+#endif
+};
+
+// Heap side of a shared counter. Counters promoted by a copy only need the
+// counts, the object is still deleted by the last owner through its own
+// pointer. Blocks created together with the object (see
+// make_single_thread_shared) set _manager and are responsible for destroying
+// the object and releasing themselves.
+// _weak_count is the number of weak pointers plus one for all the owners
+// together, so the block outlives the object as long as a weak pointer
+// refers to it.
+struct single_thread_shared_ptr_control_block {
+  using manager_fn = void (*)(single_thread_shared_ptr_control_block *,
+                              single_thread_shared_ptr_block_op) noexcept;
+
+  unsigned _count;
+  unsigned _weak_count;
+  manager_fn _manager;
+#if defined(SINGLE_THREAD_SHARED_PTR_THREAD_CHECK)
+  // thread which shared the count first, see
+  // single_thread_shared_ptr_thread_check
+  std::thread::id _owner{std::this_thread::get_id()};
+#endif
+#if defined(SINGLE_THREAD_SHARED_PTR_CYCLE_COLLECTOR)
+  // objects which may be part of a cycle, see single_thread_cycle_collector
+  bool _collectible{false};
+#endif
+
+  constexpr bool isManaged() const noexcept { return _manager != nullptr; }
+};
+
+#if defined(SINGLE_THREAD_SHARED_PTR_THREAD_CHECK)
+struct single_thread_shared_ptr_thread_violation {
+  const char *operation; // what the offending thread tried to do
+  const void *block;     // heap counter shared by the pointers
+  unsigned count;        // owners at the time of the violation
+  std::thread::id owner;
+  std::thread::id current;
+};
+
+/// Debug check that a shared counter is only used by the thread which
+/// shared it first. Enabled by defining SINGLE_THREAD_SHARED_PTR_THREAD_CHECK
+/// for every translation unit, otherwise it does not exist and the checks
+/// compile to nothing. Sole owners have no heap counter and are not checked.
+/// The default handler prints the violation and aborts, install another one
+/// to break into a debugger or collect a stack trace.
+class single_thread_shared_ptr_thread_check {
+public:
+  using handler_fn = void (*)(const single_thread_shared_ptr_thread_violation &);
+
+  /// Install a new handler, returns the previous one
+  static handler_fn setHandler(handler_fn handler) noexcept {
+    return handlerStorage().exchange(handler ? handler : &defaultHandler);
+  }
+
+  static void verify(const single_thread_shared_ptr_control_block *block,
+                     const char *operation) noexcept {
+    auto current = std::this_thread::get_id();
+    if (block->_owner != current)
+      handlerStorage().load()(single_thread_shared_ptr_thread_violation{
+          operation, block, block->_count, block->_owner, current});
+  }
+
+  static void
+  defaultHandler(const single_thread_shared_ptr_thread_violation &v) {
+    std::cerr << "single_thread_shared_ptr: " << v.operation
+              << " of the counter " << v.block << " (use count " << v.count
+              << ") on thread " << v.current << ", but it belongs to thread "
+              << v.owner << std::endl;
+    std::abort();
+  }
+
+private:
+  static std::atomic<handler_fn> &handlerStorage() noexcept {
+    static std::atomic<handler_fn> handler{&defaultHandler};
+    return handler;
+  }
+};
+
+#define SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(block, operation)                \
+  single_thread_shared_ptr_thread_check::verify(block, operation)
+#else
+#define SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(block, operation) ((void)0)
+#endif
+
+// Default storage for promoted counters: plain operator new / delete.
+struct single_thread_shared_ptr_heap_counter_allocator {
+  static void *allocate() {
+    return ::operator new(sizeof(single_thread_shared_ptr_control_block));
+  }
+
+  static void deallocate(void *ptr) noexcept { ::operator delete(ptr); }
+};
+
+#ifndef SINGLE_THREAD_SHARED_PTR_COUNTER_POOL_CAPACITY
+#define SINGLE_THREAD_SHARED_PTR_COUNTER_POOL_CAPACITY 4096
+#endif
+
+// Thread local free list of promoted counters. Released cells are kept for
+// reuse (up to the capacity) instead of being returned to the global heap,
+// so a promote / release cycle does not touch malloc. Every cell is a
+// separate allocation, thus a cell may be released on another thread than
+// it was allocated on.
+class single_thread_shared_ptr_counter_pool {
+  union Cell {
+    Cell *_next;
+    alignas(single_thread_shared_ptr_control_block) unsigned char
+        _storage[sizeof(single_thread_shared_ptr_control_block)];
+  };
+
+  struct FreeList {
+    Cell *_head{nullptr};
+    std::size_t _size{0};
+
+    ~FreeList() {
+      while (_head)
+        ::operator delete(std::exchange(_head, _head->_next));
+    }
+  };
+
+  static FreeList &freeList() noexcept {
+    thread_local FreeList list;
+    return list;
+  }
+
+public:
+  static constexpr std::size_t capacity =
+      SINGLE_THREAD_SHARED_PTR_COUNTER_POOL_CAPACITY;
+
+  static void *allocate() {
+    auto &list = freeList();
+    if (list._head) {
+      --list._size;
+      return std::exchange(list._head, list._head->_next);
+    }
+    return ::operator new(sizeof(Cell));
+  }
+
+  static void deallocate(void *ptr) noexcept {
+    auto &list = freeList();
+    if (list._size == capacity) {
+      ::operator delete(ptr);
+      return;
+    }
+    list._head = ::new (ptr) Cell{list._head};
+    ++list._size;
+  }
+
+  /// Number of cells waiting for reuse on the calling thread
+  static std::size_t size() noexcept { return freeList()._size; }
+
+  /// Return all cached cells of the calling thread to the global heap
+  static void trim() noexcept {
+    auto &list = freeList();
+    while (list._head)
+      ::operator delete(std::exchange(list._head, list._head->_next));
+    list._size = 0;
+  }
+};
+
+// Allocator used for promoted counters. It can be replaced by defining
+// SINGLE_THREAD_SHARED_PTR_COUNTER_ALLOCATOR to a type with static
+// allocate() and deallocate(void *) members, or switched to the thread local
+// pool by defining SINGLE_THREAD_SHARED_PTR_COUNTER_POOL.
+#if defined(SINGLE_THREAD_SHARED_PTR_COUNTER_ALLOCATOR)
+using single_thread_shared_ptr_counter_allocator =
+    SINGLE_THREAD_SHARED_PTR_COUNTER_ALLOCATOR;
+#elif defined(SINGLE_THREAD_SHARED_PTR_COUNTER_POOL)
+using single_thread_shared_ptr_counter_allocator =
+    single_thread_shared_ptr_counter_pool;
+#else
+using single_thread_shared_ptr_counter_allocator =
+    single_thread_shared_ptr_heap_counter_allocator;
+#endif
+
+/// Per thread queue of objects whose last owner is gone. When
+/// SINGLE_THREAD_SHARED_PTR_DEFERRED_DELETE is defined (for every translation
+/// unit) the last owner only queues the object and the event loop deletes
+/// it later with drain() or drainFor(), so tearing down a big graph does not
+/// happen inside a latency critical section. Objects queued by destructors
+/// run from the queue are appended and count against the same budget.
+/// Objects still queued when the thread exits are deleted then. Without the
+/// macro objects are deleted right away and the queue stays empty.
+class single_thread_shared_ptr_reclamation {
+public:
+#if defined(SINGLE_THREAD_SHARED_PTR_DEFERRED_DELETE)
+  static constexpr bool enabled = true;
+#else
+  static constexpr bool enabled = false;
+#endif
+
+  using destroy_fn = void (*)(void *) noexcept;
+
+  /// Queue destroy(object), runs it right away when the queue cannot grow
+  static void defer(void *object, destroy_fn destroy) noexcept {
+    try {
+      queue()._entries.push_back(Entry{object, destroy});
+    } catch (...) {
+      destroy(object);
+    }
+  }
+
+  /// Objects waiting on the calling thread
+  static std::size_t size() noexcept { return queue()._entries.size(); }
+
+  /// Delete at most budget queued objects, returns how many were deleted
+  static std::size_t drain(std::size_t budget = std::size_t(-1)) noexcept {
+    auto &q = queue();
+    std::size_t done = 0;
+    while (done < budget && q.destroyNext())
+      ++done;
+    return done;
+  }
+
+  /// Delete queued objects until budget has passed (checked after every
+  /// object), returns how many were deleted
+  template <typename _Rep, typename _Period>
+  static std::size_t
+  drainFor(std::chrono::duration<_Rep, _Period> budget) noexcept {
+    auto &q = queue();
+    auto deadline = std::chrono::steady_clock::now() + budget;
+    std::size_t done = 0;
+    while (q.destroyNext()) {
+      ++done;
+      if (std::chrono::steady_clock::now() >= deadline)
+        break;
+    }
+    return done;
+  }
+
+private:
+  struct Entry {
+    void *_object;
+    destroy_fn _destroy;
+  };
+
+  struct Queue {
+    std::deque<Entry> _entries;
+
+    ~Queue() {
+      while (destroyNext())
+        ;
+    }
+
+    // the entry is removed first, the destructor may queue new ones
+    bool destroyNext() noexcept {
+      if (_entries.empty())
+        return false;
+      Entry entry = _entries.front();
+      _entries.pop_front();
+      entry._destroy(entry._object);
+      return true;
+    }
+  };
+
+  static Queue &queue() noexcept {
+    thread_local Queue q;
+    return q;
+  }
+};
+
+// Object and its counter in one allocation
+template <typename _Tp>
+struct single_thread_shared_ptr_inplace_block
+    : single_thread_shared_ptr_control_block {
+  using object_type = std::remove_cv_t<_Tp>;
+
+  template <typename... _Args>
+  explicit single_thread_shared_ptr_inplace_block(_Args &&...__args)
+      : single_thread_shared_ptr_control_block{1, 1, &manage} {
+    ::new (static_cast<void *>(std::addressof(_object)))
+        object_type(std::forward<_Args>(__args)...);
+  }
+
+  ~single_thread_shared_ptr_inplace_block() {}
+
+  _Tp *ptr() noexcept { return std::addressof(_object); }
+
+  static void manage(single_thread_shared_ptr_control_block *cb,
+                     single_thread_shared_ptr_block_op op) noexcept {
+    auto *self = static_cast<single_thread_shared_ptr_inplace_block *>(cb);
+    if (op == single_thread_shared_ptr_block_op::dispose)
+      self->_object.~object_type();
+    else
+      delete self;
+  }
+
+  union {
+    object_type _object;
+  };
+};
+
+// Array elements following their counter in one allocation. Elements are
+// value initialized, or default initialized (left unset for trivial types)
+// by make_single_thread_shared_for_overwrite.
+template <typename _Elem>
+struct single_thread_shared_ptr_array_block
+    : single_thread_shared_ptr_control_block {
+  static_assert(!std::is_array_v<_Elem>,
+                "multidimensional arrays are not supported");
+  using object_type = std::remove_cv_t<_Elem>;
+
+  static constexpr std::size_t alignment =
+      std::max(alignof(single_thread_shared_ptr_control_block),
+               alignof(object_type));
+
+  // elements start at the first suitably aligned byte after the block
+  static constexpr std::size_t offset() noexcept {
+    return (sizeof(single_thread_shared_ptr_array_block) +
+            alignof(object_type) - 1) /
+           alignof(object_type) * alignof(object_type);
+  }
+
+  explicit single_thread_shared_ptr_array_block(std::size_t size) noexcept
+      : single_thread_shared_ptr_control_block{1, 1, &manage}, _size{size} {}
+
+  _Elem *ptr() noexcept {
+    return reinterpret_cast<_Elem *>(reinterpret_cast<unsigned char *>(this) +
+                                     offset());
+  }
+
+  template <bool _ValueInit>
+  static single_thread_shared_ptr_array_block *create(std::size_t size) {
+    if (size > (std::size_t(-1) - offset()) / sizeof(object_type))
+      throw std::bad_array_new_length();
+    auto *block = ::new (allocate(offset() + size * sizeof(object_type)))
+        single_thread_shared_ptr_array_block(size);
+    auto *first = const_cast<object_type *>(block->ptr());
+    std::size_t i = 0;
+    try {
+      for (; i < size; ++i) {
+        if constexpr (_ValueInit)
+          ::new (static_cast<void *>(first + i)) object_type();
+        else
+          ::new (static_cast<void *>(first + i)) object_type;
+      }
+    } catch (...) {
+      while (i > 0)
+        first[--i].~object_type();
+      deallocate(block);
+      throw;
+    }
+    return block;
+  }
+
+  static void manage(single_thread_shared_ptr_control_block *cb,
+                     single_thread_shared_ptr_block_op op) noexcept {
+    auto *self = static_cast<single_thread_shared_ptr_array_block *>(cb);
+    if (op == single_thread_shared_ptr_block_op::dispose) {
+      auto *first = const_cast<object_type *>(self->ptr());
+      for (std::size_t i = self->_size; i > 0; --i)
+        first[i - 1].~object_type();
+    } else {
+      deallocate(self);
+    }
+  }
+
+  std::size_t _size;
+
+private:
+  static void *allocate(std::size_t bytes) {
+    if constexpr (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+      return ::operator new(bytes, std::align_val_t{alignment});
+    else
+      return ::operator new(bytes);
+  }
+
+  static void deallocate(single_thread_shared_ptr_array_block *block) noexcept {
+    block->~single_thread_shared_ptr_array_block();
+    if constexpr (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+      ::operator delete(static_cast<void *>(block),
+                        std::align_val_t{alignment});
+    else
+      ::operator delete(static_cast<void *>(block));
+  }
+};
+
+// Counter of an object released by a user supplied deleter. Only pointers
+// constructed with a deleter use it, the others keep the plain counter.
+template <typename _Ptr, typename _Deleter>
+struct single_thread_shared_ptr_deleter_block
+    : single_thread_shared_ptr_control_block {
+  single_thread_shared_ptr_deleter_block(_Ptr ptr, _Deleter &&deleter)
+      : single_thread_shared_ptr_control_block{1, 1, &manage},
+        _ptr{std::move(ptr)}, _deleter{std::move(deleter)} {}
+
+  static void manage(single_thread_shared_ptr_control_block *cb,
+                     single_thread_shared_ptr_block_op op) noexcept {
+    auto *self = static_cast<single_thread_shared_ptr_deleter_block *>(cb);
+    if (op == single_thread_shared_ptr_block_op::dispose)
+      self->_deleter(self->_ptr);
+    else
+      delete self;
+  }
+
+  _Ptr _ptr;
+  _Deleter _deleter;
+};
+
+// Block which holds another owner of the object instead of a pointer (see
+// the aliasing constructor). That owner shares a counter with owners the
+// block cannot see, so the block keeps a weak reference standing for them
+// until it gives its owner up: owners of the block are never unique and
+// cannot hand the object to another thread.
+template <typename _Owner>
+struct single_thread_shared_ptr_owner_block
+    : single_thread_shared_ptr_control_block {
+  explicit single_thread_shared_ptr_owner_block(_Owner &&owner) noexcept
+      : single_thread_shared_ptr_control_block{1, 2, &manage},
+        _owner{std::move(owner)} {}
+
+  static void manage(single_thread_shared_ptr_control_block *cb,
+                     single_thread_shared_ptr_block_op op) noexcept {
+    auto *self = static_cast<single_thread_shared_ptr_owner_block *>(cb);
+    if (op == single_thread_shared_ptr_block_op::dispose) {
+      self->_owner.reset();
+      --self->_weak_count;
+    } else {
+      delete self;
+    }
+  }
+
+  _Owner _owner;
+};
+
+// Object and its counter in one allocation obtained from a user allocator.
+// The object is constructed and destroyed through the allocator, so
+// std::pmr allocators propagate their resource to the object.
+template <typename _Tp, typename _Alloc>
+struct single_thread_shared_ptr_alloc_block
+    : single_thread_shared_ptr_control_block {
+  using allocator_type = typename std::allocator_traits<
+      _Alloc>::template rebind_alloc<single_thread_shared_ptr_alloc_block>;
+  using allocator_traits = std::allocator_traits<allocator_type>;
+  using object_type = std::remove_cv_t<_Tp>;
+  using object_allocator_type = typename std::allocator_traits<
+      _Alloc>::template rebind_alloc<object_type>;
+  using object_allocator_traits = std::allocator_traits<object_allocator_type>;
+
+  explicit single_thread_shared_ptr_alloc_block(const allocator_type &alloc)
+      : single_thread_shared_ptr_control_block{1, 1, &manage}, _alloc{alloc} {}
+
+  ~single_thread_shared_ptr_alloc_block() {}
+
+  _Tp *ptr() noexcept { return std::addressof(_object); }
+
+  template <typename... _Args>
+  static single_thread_shared_ptr_alloc_block *create(const _Alloc &alloc,
+                                                      _Args &&...__args) {
+    allocator_type a{alloc};
+    auto mem = allocator_traits::allocate(a, 1);
+    auto *block = ::new (static_cast<void *>(std::addressof(*mem)))
+        single_thread_shared_ptr_alloc_block(a);
+    try {
+      object_allocator_type oa{a};
+      object_allocator_traits::construct(oa, std::addressof(block->_object),
+                                         std::forward<_Args>(__args)...);
+    } catch (...) {
+      block->~single_thread_shared_ptr_alloc_block();
+      allocator_traits::deallocate(a, mem, 1);
+      throw;
+    }
+    return block;
+  }
+
+  static void manage(single_thread_shared_ptr_control_block *cb,
+                     single_thread_shared_ptr_block_op op) noexcept {
+    auto *self = static_cast<single_thread_shared_ptr_alloc_block *>(cb);
+    if (op == single_thread_shared_ptr_block_op::dispose) {
+      object_allocator_type oa{self->_alloc};
+      object_allocator_traits::destroy(oa, std::addressof(self->_object));
+      return;
+    }
+
+    allocator_type a{std::move(self->_alloc)};
+    self->~single_thread_shared_ptr_alloc_block();
+    allocator_traits::deallocate(
+        a, std::pointer_traits<typename allocator_traits::pointer>::pointer_to(
+               *self),
+        1);
+  }
+
+  allocator_type _alloc;
+  union {
+    object_type _object;
+  };
+};
+
 class single_thread_shared_ptr_counter {
   union Storage {
-    constexpr Storage(unsigned value) : _local{value} {}
-    unsigned _local; // optimization for count == 1 and empty counter
-    unsigned
-        *_global; // stack based counter, needed when there is more then
+    constexpr Storage(std::uintptr_t value) : _local{value} {}
+    constexpr Storage(single_thread_shared_ptr_control_block *block)
+        : _global{block} {}
+    std::uintptr_t _local; // optimization for count == 1 and empty counter
+    single_thread_shared_ptr_control_block
+        *_global; // heap based counter, needed when there is more then
                   // one single_thread_shared_ptr pointing to the same object
   };
 
-  static constexpr Storage zero() { return 0; }
-  static constexpr Storage one() { return 1; }
+  static constexpr Storage zero() { return std::uintptr_t{0}; }
+  static constexpr Storage one() { return std::uintptr_t{1}; }
 
 public:
   constexpr single_thread_shared_ptr_counter(bool) noexcept
       : _storage{zero()} {}
   constexpr single_thread_shared_ptr_counter() noexcept : _storage{one()} {}
 
+  // adopts a block which already accounts for this owner. Blocks are never
+  // one of the inline states, knowing it the optimizer turns copies of a
+  // new pointer into an increment instead of a promotion.
+  explicit single_thread_shared_ptr_counter(
+      single_thread_shared_ptr_control_block *block) noexcept
+      : _storage{block} {
+    SINGLE_THREAD_SHARED_PTR_ASSUME(isGlobalCounter());
+  }
+
+  // new owner of the object guarded by block, empty when it already expired
+  static single_thread_shared_ptr_counter
+  lock(single_thread_shared_ptr_control_block *block) noexcept {
+    if (!block)
+      return single_thread_shared_ptr_counter{true};
+    SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(block, "lock");
+    if (block->_count == 0)
+      return single_thread_shared_ptr_counter{true};
+    ++block->_count;
+    return single_thread_shared_ptr_counter{block};
+  }
+
   single_thread_shared_ptr_counter(
       const single_thread_shared_ptr_counter &rhs) noexcept
       : _storage{rhs.increment()} {}
@@ -57,39 +709,171 @@ public:
   }
 
   ~single_thread_shared_ptr_counter() noexcept {
-    if (isGlobalCounter() && --(*_storage._global) == 0) {
-      delete _storage._global;
-    } else
+    if (isGlobalCounter())
+      SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(_storage._global, "release");
+    if (isGlobalCounter() && --_storage._global->_count == 0) {
+      release(_storage._global);
+    } else {
+#if defined(SINGLE_THREAD_SHARED_PTR_CYCLE_COLLECTOR)
+      possibleRoot();
+#endif
       _storage._local = 0;
+    }
   }
 
   void globalCounterCleanup() noexcept {
-    if (isGlobalCounter() && --(*_storage._global) == 0) {
-      delete _storage._global;
+    if (isGlobalCounter())
+      SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(_storage._global, "release");
+    if (isGlobalCounter() && --_storage._global->_count == 0) {
+      release(_storage._global);
       _storage._local = 0;
     }
+#if defined(SINGLE_THREAD_SHARED_PTR_CYCLE_COLLECTOR)
+    else
+      possibleRoot();
+#endif
   }
 
   unsigned count() const noexcept {
-    return isGlobalCounter() ? *_storage._global : _storage._local;
+    return isGlobalCounter() ? _storage._global->_count
+                             : static_cast<unsigned>(_storage._local);
   }
 
   constexpr bool isNone() const noexcept { return _storage._local == 0; }
 
+  // sole owner keeping its count inline
+  constexpr bool isLocal() const noexcept { return _storage._local == 1; }
+
   bool isLast() const noexcept {
     return _storage._local == 1 ||
-           (_storage._local == 0 ? false : (*_storage._global == 1));
+           (_storage._local == 0 ? false : (_storage._global->_count == 1));
+  }
+
+  // no other owner and no weak reference, so writes to the object cannot be
+  // observed; a sole owner keeping its count inline needs one compare
+  bool isUnique() const noexcept {
+    if (isLocal())
+      return true;
+    return isGlobalCounter() && _storage._global->_count == 1 &&
+           _storage._global->_weak_count == 1;
   }
 
   constexpr bool isGlobalCounter() const noexcept {
     return _storage._local > 1;
   }
 
+  // heap counter, nullptr for a sole owner keeping its count inline
+  single_thread_shared_ptr_control_block *block() const noexcept {
+    return isGlobalCounter() ? _storage._global : nullptr;
+  }
+
+  // the owner is about to delete the object
+  void checkDelete() const noexcept {
+    if (isGlobalCounter())
+      SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(_storage._global, "delete");
+  }
+
+  // true when the control block, not the owner, destroys the object
+  bool isManaged() const noexcept {
+    return isGlobalCounter() && _storage._global->isManaged();
+  }
+
+  // block for a new weak reference; a sole owner has no block yet, so it is
+  // promoted here (only code that uses weak pointers pays for it)
+  single_thread_shared_ptr_control_block *acquireWeak() const {
+    if (isNone())
+      return nullptr;
+    if (_storage._local == 1)
+      _storage._global = promote(1);
+    SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(_storage._global, "weak reference");
+    ++_storage._global->_weak_count;
+    return _storage._global;
+  }
+
+  // Gives up a sole owner without weak references so the object can leave
+  // the thread: returns its managed block, or nullptr when the owner deletes
+  // the object itself (a promoted cell is freed). Throws std::logic_error
+  // while the object is shared or observed.
+  single_thread_shared_ptr_control_block *releaseUnique() {
+    single_thread_shared_ptr_control_block *block = nullptr;
+    if (isGlobalCounter()) {
+      block = _storage._global;
+      SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(block, "handoff");
+      if (block->_count != 1 || block->_weak_count != 1)
+        throw std::logic_error(
+            "single_thread_shared_ptr: handoff of a shared object");
+      if (!block->isManaged()) {
+        SINGLE_THREAD_SHARED_PTR_RECORD(onCounterFree);
+        single_thread_shared_ptr_counter_allocator::deallocate(block);
+        block = nullptr;
+      }
+    }
+    _storage = zero();
+    return block;
+  }
+
+  // promoted cell left to a single owner without weak references
+  bool isSoleCell() const noexcept {
+    return isGlobalCounter() && !_storage._global->isManaged() &&
+           _storage._global->_count == 1 &&
+           _storage._global->_weak_count == 1;
+  }
+
+  // a sole owner moves its count to block, created with a count of one; the
+  // promoted cell of a survivor is freed
+  void adopt(single_thread_shared_ptr_control_block *block) const noexcept {
+    assert(isLocal() || isSoleCell());
+    if (isGlobalCounter()) {
+      SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(_storage._global, "adopt");
+      SINGLE_THREAD_SHARED_PTR_RECORD(onCounterFree);
+      single_thread_shared_ptr_counter_allocator::deallocate(_storage._global);
+    }
+    _storage._global = block;
+  }
+
+  // The last owner of a promoted cell gives its count up before it deletes
+  // the object, so the object's destructor cannot lock a weak pointer to it
+  // and a count known to drop to zero folds away. Weak references are
+  // released afterwards with releaseCell(), the destructor may drop some.
+  single_thread_shared_ptr_control_block *detachCell() noexcept {
+    auto *block = _storage._global;
+    SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(block, "release");
+    block->_count = 0;
+    _storage = zero();
+    return block;
+  }
+
+  static void
+  releaseCell(single_thread_shared_ptr_control_block *block) noexcept {
+    if (--block->_weak_count != 0)
+      return;
+    SINGLE_THREAD_SHARED_PTR_RECORD(onCounterFree);
+    single_thread_shared_ptr_counter_allocator::deallocate(block);
+  }
+
+  static void
+  releaseWeak(single_thread_shared_ptr_control_block *block) noexcept {
+    if (--block->_weak_count != 0)
+      return;
+    SINGLE_THREAD_SHARED_PTR_RECORD(onCounterFree);
+    if (block->isManaged())
+      block->_manager(block, single_thread_shared_ptr_block_op::destroy);
+    else
+      single_thread_shared_ptr_counter_allocator::deallocate(block);
+  }
+
+  // a copy of an empty counter stays empty, so copies of a pointer without
+  // a count (single_thread_lookup_key, aliases of empty pointers) own
+  // nothing either
   Storage increment() const {
     if (_storage._local == 1) {
-      _storage._global = new unsigned(2);
-    } else
-      isNone() ? _storage._local = 1 : ++(*_storage._global);
+      _storage._global = promote(2);
+      // lets the owners dropping the copies skip the inline states
+      SINGLE_THREAD_SHARED_PTR_ASSUME(isGlobalCounter());
+    } else if (!isNone()) {
+      SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(_storage._global, "copy");
+      ++_storage._global->_count;
+    }
 
     return _storage;
   }
@@ -98,14 +882,85 @@ public:
     std::swap(_storage, rhs._storage);
   }
 
+  // The other owners of a promoted counter cannot reach the survivor, so
+  // the owner frees the heap counter when it is asked to. Blocks which
+  // destroy the object or have weak references stay where they are.
+  // Returns true when the count is inline afterwards.
+  bool reclaim() noexcept {
+    if (!isSoleCell())
+      return isLocal();
+    SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(_storage._global, "reclaim");
+    SINGLE_THREAD_SHARED_PTR_RECORD(onReclaim);
+    single_thread_shared_ptr_counter_allocator::deallocate(_storage._global);
+    _storage._local = 1;
+    return true;
+  }
+
 private:
+
+#if defined(SINGLE_THREAD_SHARED_PTR_CYCLE_COLLECTOR)
+  // the remaining owners may only be kept alive by a cycle
+  void possibleRoot() const noexcept {
+    if (isGlobalCounter() && _storage._global->_collectible)
+      _storage._global->_manager(
+          _storage._global, single_thread_shared_ptr_block_op::possible_root);
+  }
+#endif
+
+  // heap counter for a sole owner which gets company
+  static single_thread_shared_ptr_control_block *promote(unsigned count) {
+    SINGLE_THREAD_SHARED_PTR_RECORD(onPromotion);
+    return ::new (single_thread_shared_ptr_counter_allocator::allocate())
+        single_thread_shared_ptr_control_block{count, 1, nullptr};
+  }
+
+  // called after the last owner is gone; kept out of line so the owner
+  // destructors stay small enough to be inlined and folded away
+  SINGLE_THREAD_SHARED_PTR_NOINLINE static void release(
+      single_thread_shared_ptr_control_block *block) noexcept {
+    if (block->isManaged()) {
+      SINGLE_THREAD_SHARED_PTR_RECORD(onObjectDelete);
+#if defined(SINGLE_THREAD_SHARED_PTR_DEFERRED_DELETE)
+      single_thread_shared_ptr_reclamation::defer(block, &disposeBlock);
+      return;
+#else
+      block->_manager(block, single_thread_shared_ptr_block_op::dispose);
+#endif
+    }
+    releaseWeak(block);
+  }
+
+#if defined(SINGLE_THREAD_SHARED_PTR_DEFERRED_DELETE)
+  static void disposeBlock(void *ptr) noexcept {
+    auto *block = static_cast<single_thread_shared_ptr_control_block *>(ptr);
+    block->_manager(block, single_thread_shared_ptr_block_op::dispose);
+    releaseWeak(block);
+  }
+#endif
+
   mutable Storage _storage;
 };
 
 // forward declarations
 template <typename _Tp> class single_thread_shared_ptr;
+template <typename _Tp> class single_thread_weak_ptr;
+template <typename _Tp> class enable_single_thread_shared_from_this;
+template <typename _Tp> class single_thread_handoff;
 
-template <typename _Tp, bool = std::is_void_v<_Tp>>
+struct single_thread_shared_ptr_factory;
+
+// Detects an unambiguous enable_single_thread_shared_from_this base of _Yp
+// through the friend function defined in that base.
+template <typename _Yp, typename = void>
+struct __sp_has_shared_from_this : std::false_type {};
+
+template <typename _Yp>
+struct __sp_has_shared_from_this<
+    _Yp, std::void_t<decltype(__enable_single_thread_shared_from_this_base(
+             std::declval<_Yp *>()))>> : std::true_type {};
+
+template <typename _Tp, bool = std::is_array_v<_Tp>,
+          bool = std::is_void_v<_Tp>>
 class single_thread_shared_ptr_access {
 public:
   using element_type = _Tp;
@@ -126,7 +981,8 @@ private:
 };
 
 // Define operator-> for shared_ptr<cv void>.
-template <typename _Tp> class single_thread_shared_ptr_access<_Tp, true> {
+template <typename _Tp>
+class single_thread_shared_ptr_access<_Tp, false, true> {
 public:
   using element_type = _Tp;
 
@@ -137,6 +993,25 @@ public:
   }
 };
 
+// Define operator[] for shared_ptr<T[]> and shared_ptr<T[N]>.
+template <typename _Tp>
+class single_thread_shared_ptr_access<_Tp, true, false> {
+public:
+  using element_type = std::remove_extent_t<_Tp>;
+
+  element_type &operator[](std::ptrdiff_t __i) const noexcept {
+    assert(_M_get() != nullptr);
+    assert(!std::extent_v<_Tp> ||
+           (__i >= 0 && static_cast<std::size_t>(__i) < std::extent_v<_Tp>));
+    return _M_get()[__i];
+  }
+
+private:
+  element_type *_M_get() const noexcept {
+    return static_cast<const single_thread_shared_ptr<_Tp> *>(this)->get();
+  }
+};
+
 template <typename T>
 class single_thread_shared_ptr : public single_thread_shared_ptr_access<T> {
 private:
@@ -145,6 +1020,19 @@ private:
   using _SafeConv =
       typename std::enable_if<__sp_is_constructible<T, _Yp>::value>::type;
 
+  // Constraint for taking ownership with a deleter:
+  template <typename _Yp, typename _Deleter>
+  using _DeleterConv =
+      typename std::enable_if<__sp_is_constructible<T, _Yp>::value &&
+                              std::is_invocable_v<_Deleter &, _Yp *>>::type;
+
+  // Constraint for taking over a std::unique_ptr:
+  template <typename _Yp, typename _Del>
+  using _UniqueConv = typename std::enable_if<
+      std::is_array_v<_Yp> == std::is_array_v<T> &&
+      std::is_convertible_v<typename std::unique_ptr<_Yp, _Del>::pointer,
+                            std::remove_extent_t<T> *>>::type;
+
   // Constraint for construction from shared_ptr and weak_ptr:
   template <typename _Yp, typename _Res = void>
   using _Compatible =
@@ -153,28 +1041,98 @@ private:
 
 public:
   using element_type = typename std::remove_extent_t<T>;
+  // no pointers into itself, so a bitwise copy of the source followed by
+  // forgetting it is a valid move, see single_thread_is_trivially_relocatable
+  using trivially_relocatable = std::true_type;
 
   constexpr single_thread_shared_ptr() noexcept
       : _M_ptr{nullptr}, _counter{true} {}
 
   template <typename _Yp, typename = _SafeConv<_Yp>>
-  constexpr single_thread_shared_ptr(_Yp *_M_ptr) noexcept
-      : _M_ptr{_M_ptr}, _counter{} {
+  constexpr single_thread_shared_ptr(_Yp *_M_ptr) noexcept(
+      !__sp_has_shared_from_this<_Yp>::value)
+      : _M_ptr{_M_ptr}, _counter{ownerCounter(_M_ptr)} {
     static_assert(!std::is_void_v<_Yp>, "incomplete type");
     static_assert(sizeof(_Yp) > 0, "incomplete type");
+    enableSharedFromThis(_M_ptr);
+  }
+
+  constexpr single_thread_shared_ptr(element_type *_M_ptr) noexcept(
+      !__sp_has_shared_from_this<element_type>::value)
+      : _M_ptr{_M_ptr}, _counter{ownerCounter(_M_ptr)} {
+    enableSharedFromThis(_M_ptr);
+  }
+
+  // the object is released with deleter(ptr) instead of delete, the deleter
+  // is also called when allocating its counter fails
+  template <typename _Yp, typename _Deleter,
+            typename = _DeleterConv<_Yp, _Deleter>>
+  single_thread_shared_ptr(_Yp *ptr, _Deleter deleter)
+      : _M_ptr{ptr}, _counter{deleterBlock(ptr, std::move(deleter))} {
+    enableSharedFromThis(ptr);
   }
 
-  constexpr single_thread_shared_ptr(T *_M_ptr) noexcept
-      : _M_ptr{_M_ptr}, _counter{} {}
+  template <typename _Deleter,
+            typename = std::enable_if_t<
+                std::is_invocable_v<_Deleter &, element_type *>>>
+  single_thread_shared_ptr(std::nullptr_t, _Deleter deleter)
+      : _M_ptr{nullptr}, _counter{deleterBlock(
+                             static_cast<element_type *>(nullptr),
+                             std::move(deleter))} {}
+
+  // takes over the object without moving it, only a custom deleter needs a
+  // heap counter
+  template <typename _Yp, typename _Del, typename = _UniqueConv<_Yp, _Del>>
+  single_thread_shared_ptr(std::unique_ptr<_Yp, _Del> &&rhs)
+      : single_thread_shared_ptr() {
+    if (!rhs)
+      return;
+    if constexpr (std::is_same_v<_Del, std::default_delete<_Yp>>) {
+      single_thread_shared_ptr(rhs.release()).swap(*this);
+    } else {
+      using _Ptr = typename std::unique_ptr<_Yp, _Del>::pointer;
+      using _Stored = std::conditional_t<
+          std::is_reference_v<_Del>,
+          std::reference_wrapper<std::remove_reference_t<_Del>>, _Del>;
+      auto *block = new single_thread_shared_ptr_deleter_block<_Ptr, _Stored>(
+          rhs.get(), _Stored(std::forward<_Del>(rhs.get_deleter())));
+      SINGLE_THREAD_SHARED_PTR_RECORD(onCounterAllocation);
+      single_thread_shared_ptr(rhs.release(), block).swap(*this);
+    }
+  }
 
-  // aliasing ctor
+  // aliasing ctor, p shares the ownership of r. The object has to be
+  // deleted through r's pointer, so a sole owner moves its count into a
+  // block which remembers it; objects with a managed block need nothing.
   template <class Y>
-  single_thread_shared_ptr(const single_thread_shared_ptr<Y> &r, T *p) noexcept
-      : _M_ptr{p}, _counter{r._counter} {}
+  single_thread_shared_ptr(const single_thread_shared_ptr<Y> &r,
+                           element_type *p)
+      : _M_ptr{p}, _counter{aliasCounter(r)} {}
+
+  // like the aliasing ctor, but takes over the count of r instead of adding
+  // an owner
+  template <class Y>
+  single_thread_shared_ptr(single_thread_shared_ptr<Y> &&r, element_type *p)
+      : _M_ptr{p}, _counter{aliasCounter(std::move(r))} {
+    r._M_ptr = nullptr;
+  }
 
   single_thread_shared_ptr(const single_thread_shared_ptr &rhs) noexcept
       : _M_ptr{rhs._M_ptr}, _counter{rhs._counter} {}
 
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  single_thread_shared_ptr(const single_thread_shared_ptr<_Yp> &rhs) noexcept
+      : _M_ptr{rhs._M_ptr}, _counter{rhs._counter} {}
+
+  // throws std::bad_weak_ptr when the object is already gone
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  explicit single_thread_shared_ptr(const single_thread_weak_ptr<_Yp> &rhs)
+      : _M_ptr{rhs._M_ptr}, _counter{single_thread_shared_ptr_counter::lock(
+                                rhs._block)} {
+    if (_counter.isNone())
+      throw std::bad_weak_ptr();
+  }
+
   template <typename _Yp, typename = _Compatible<_Yp>>
   constexpr single_thread_shared_ptr(
       single_thread_shared_ptr<_Yp> &&rhs) noexcept
@@ -186,18 +1144,14 @@ public:
                                                         rhs._counter)} {}
 
   single_thread_shared_ptr &operator=(const single_thread_shared_ptr &rhs) {
-    if (_counter.isLast()) {
-      delete _M_ptr;
-    }
+    destroyIfLastOwner();
     _M_ptr = rhs._M_ptr;
     _counter = rhs._counter;
     return *this;
   }
 
   single_thread_shared_ptr &operator=(single_thread_shared_ptr &&rhs) noexcept {
-    if (_counter.isLast()) {
-      delete _M_ptr;
-    }
+    destroyIfLastOwner();
     _M_ptr = std::exchange(rhs._M_ptr, nullptr);
     _counter = std::move(rhs._counter);
     return *this;
@@ -206,14 +1160,19 @@ public:
   ~single_thread_shared_ptr() noexcept {
     if (!_M_ptr)
       return;
-    if (_counter.isLast())
-      delete _M_ptr;
+    destroyIfLastOwner();
   }
 
   element_type *get() const noexcept { return _M_ptr; }
 
   long use_count() const noexcept { return _counter.count(); }
 
+  /// Free the heap counter of a pointer created from a raw pointer once its
+  /// copies are gone, so it keeps its count inline again. Counters with
+  /// weak references and blocks of the make functions stay. Returns true
+  /// when the count is inline.
+  bool reclaim_counter() noexcept { return _counter.reclaim(); }
+
   void swap(single_thread_shared_ptr<T> &rhs) noexcept {
     std::swap(_M_ptr, rhs._M_ptr);
     _counter.swap(rhs._counter);
@@ -229,15 +1188,640 @@ public:
     single_thread_shared_ptr(rhs).swap(*this);
   }
 
+  template <typename _Yp, typename _Deleter>
+  _SafeConv<_Yp> reset(_Yp *rhs, _Deleter deleter) {
+    assert(rhs == 0 || rhs != _M_ptr);
+    single_thread_shared_ptr(rhs, std::move(deleter)).swap(*this);
+  }
+
   explicit operator bool() const noexcept { return _M_ptr == 0 ? false : true; }
 
+  /// Gives up the object so it can be moved to another thread, the pointer
+  /// is empty afterwards. Throws std::logic_error when other owners or weak
+  /// pointers exist, the object is never copied.
+  single_thread_handoff<T> release_to_thread() {
+    auto *block = _counter.releaseUnique();
+    return single_thread_handoff<T>(std::exchange(_M_ptr, nullptr), block);
+  }
+
+  /// Moves the object into a std::shared_ptr, which may be shared between
+  /// threads. Same requirements as release_to_thread().
+  std::shared_ptr<T> into_std_shared() {
+    return release_to_thread().into_std_shared();
+  }
+
   template <typename _Yp> friend class single_thread_shared_ptr;
+  template <typename _Yp> friend class single_thread_weak_ptr;
+  template <typename _Yp> friend class single_thread_handoff;
+
+  friend struct single_thread_shared_ptr_factory;
 
 private:
-  T *_M_ptr;
+  // takes over a block whose count already includes this owner
+  single_thread_shared_ptr(element_type *ptr,
+                           single_thread_shared_ptr_control_block *block) noexcept
+      : _M_ptr{ptr}, _counter{block} {
+    enableSharedFromThis(ptr);
+  }
+
+  // a sole owner keeps its count inline, unless the object hands out
+  // pointers to itself: then it needs a block it can reach
+  template <typename _Yp>
+  static constexpr single_thread_shared_ptr_counter ownerCounter(_Yp *ptr) {
+    if constexpr (__sp_has_shared_from_this<_Yp>::value) {
+      if (ptr)
+        return single_thread_shared_ptr_counter{
+            deleterBlock(ptr, std::default_delete<_Yp>())};
+    }
+    return single_thread_shared_ptr_counter{};
+  }
+
+  template <typename _Yp> void enableSharedFromThis(_Yp *ptr) {
+    if constexpr (__sp_has_shared_from_this<_Yp>::value) {
+      if (ptr)
+        __enable_single_thread_shared_from_this_base(ptr)->assignWeakThis(
+            ptr, _counter);
+    }
+  }
+
+  single_thread_shared_ptr(element_type *ptr,
+                           single_thread_shared_ptr_counter &&counter) noexcept
+      : _M_ptr{counter.isNone() ? nullptr : ptr}, _counter{std::move(counter)} {}
+
+  // Counter for an alias of r. A sole owner (a survivor of a promotion frees
+  // its cell) moves its count into a block which deletes the object through
+  // r's pointer. Raw pointer owners which still share a promoted counter
+  // (with other owners or weak pointers) delete the object themselves, so
+  // the alias gets a block holding one more of them instead, and the last
+  // owner of either kind deletes the object through its own pointer. Such
+  // an alias counts only the owners of its block and is never unique.
+  template <typename _Yp>
+  static single_thread_shared_ptr_counter
+  aliasCounter(const single_thread_shared_ptr<_Yp> &r) {
+    if (r.sharesCell())
+      return ownerCounter(single_thread_shared_ptr<_Yp>(r));
+    if (!r.prepareAlias())
+      return single_thread_shared_ptr_counter{true};
+    return r._counter;
+  }
+
+  template <typename _Yp>
+  static single_thread_shared_ptr_counter
+  aliasCounter(single_thread_shared_ptr<_Yp> &&r) {
+    if (r.sharesCell())
+      return ownerCounter(std::move(r));
+    if (!r.prepareAlias())
+      return single_thread_shared_ptr_counter{true};
+    return std::move(r._counter);
+  }
+
+  // promoted cell the owners still delete the object through
+  bool sharesCell() const noexcept {
+    return _counter.isGlobalCounter() && !_counter.isManaged() &&
+           !_counter.isSoleCell();
+  }
+
+  // the owner moves into the block only once it is allocated
+  template <typename _Yp>
+  static single_thread_shared_ptr_counter
+  ownerCounter(single_thread_shared_ptr<_Yp> &&owner) {
+    auto *block =
+        new single_thread_shared_ptr_owner_block<single_thread_shared_ptr<_Yp>>(
+            std::move(owner));
+    SINGLE_THREAD_SHARED_PTR_RECORD(onCounterAllocation);
+    return single_thread_shared_ptr_counter{block};
+  }
+
+  // false when there is no ownership to share
+  bool prepareAlias() const {
+    if (!_counter.isLocal() && !_counter.isSoleCell())
+      return !_counter.isNone();
+    if (!_M_ptr)
+      return false;
+    if constexpr (!std::is_void_v<T>) {
+      using _Deleter =
+          std::conditional_t<std::is_array_v<T>,
+                             std::default_delete<element_type[]>,
+                             std::default_delete<T>>;
+      _counter.adopt(
+          new single_thread_shared_ptr_deleter_block<element_type *, _Deleter>(
+              _M_ptr, _Deleter()));
+      SINGLE_THREAD_SHARED_PTR_RECORD(onCounterAllocation);
+    }
+    return true;
+  }
+
+  template <typename _Ptr, typename _Deleter>
+  static single_thread_shared_ptr_control_block *
+  deleterBlock(_Ptr ptr, _Deleter &&deleter) {
+    try {
+      auto *block = new single_thread_shared_ptr_deleter_block<_Ptr, _Deleter>(
+          ptr, std::move(deleter));
+      SINGLE_THREAD_SHARED_PTR_RECORD(onCounterAllocation);
+      return block;
+    } catch (...) {
+      deleter(ptr);
+      throw;
+    }
+  }
+
+  // managed blocks destroy the object themselves when the counter drops
+  void destroyIfLastOwner() noexcept {
+#if defined(__GNUC__) && !defined(__clang__)
+// gcc cannot always prove that co-allocated objects never reach this delete
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfree-nonheap-object"
+#endif
+    if (_counter.isLast() && !_counter.isManaged()) {
+      _counter.checkDelete();
+      auto *cell = _counter.isGlobalCounter() ? _counter.detachCell() : nullptr;
+      if (_M_ptr)
+        SINGLE_THREAD_SHARED_PTR_RECORD(onObjectDelete);
+#if defined(SINGLE_THREAD_SHARED_PTR_DEFERRED_DELETE)
+      if (_M_ptr)
+        single_thread_shared_ptr_reclamation::defer(
+            const_cast<void *>(static_cast<const volatile void *>(_M_ptr)),
+            &deleteObject);
+#else
+      if constexpr (std::is_array_v<T>)
+        delete[] _M_ptr;
+      else
+        delete _M_ptr;
+#endif
+      if (cell)
+        single_thread_shared_ptr_counter::releaseCell(cell);
+    }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+  }
+
+#if defined(SINGLE_THREAD_SHARED_PTR_DEFERRED_DELETE)
+  static void deleteObject(void *ptr) noexcept {
+    if constexpr (std::is_array_v<T>)
+      delete[] static_cast<element_type *>(ptr);
+    else
+      delete static_cast<element_type *>(ptr);
+  }
+#endif
+
+  element_type *_M_ptr;
   single_thread_shared_ptr_counter _counter;
 };
 
+// Wraps freshly created control blocks into pointers for the factory
+// functions below.
+struct single_thread_shared_ptr_factory {
+  template <typename _Tp>
+  static single_thread_shared_ptr<_Tp>
+  adopt(typename single_thread_shared_ptr<_Tp>::element_type *ptr,
+        single_thread_shared_ptr_control_block *block) noexcept {
+    return single_thread_shared_ptr<_Tp>(ptr, block);
+  }
+
+  // Pointer of another type to the same object sharing the count of r,
+  // empty when ptr is null. Like after an implicit conversion the last
+  // owner deletes the object through the new pointer, so the inline count
+  // of a sole owner moves along and nothing is allocated.
+  template <typename _Tp, typename _Yp>
+  static single_thread_shared_ptr<_Tp>
+  convert(const single_thread_shared_ptr<_Yp> &r,
+          typename single_thread_shared_ptr<_Tp>::element_type *ptr) {
+    if (!ptr)
+      return single_thread_shared_ptr<_Tp>();
+    return single_thread_shared_ptr<_Tp>(
+        ptr, single_thread_shared_ptr_counter(r._counter));
+  }
+
+  // r keeps the object when ptr is null
+  template <typename _Tp, typename _Yp>
+  static single_thread_shared_ptr<_Tp>
+  convert(single_thread_shared_ptr<_Yp> &&r,
+          typename single_thread_shared_ptr<_Tp>::element_type *ptr) noexcept {
+    if (!ptr)
+      return single_thread_shared_ptr<_Tp>();
+    r._M_ptr = nullptr;
+    return single_thread_shared_ptr<_Tp>(ptr, std::move(r._counter));
+  }
+
+  // heap counter of r, nullptr when r keeps its count inline
+  template <typename _Tp>
+  static single_thread_shared_ptr_control_block *
+  block(const single_thread_shared_ptr<_Tp> &r) noexcept {
+    return r._counter.block();
+  }
+
+  // r is the only owner and nothing observes the object
+  template <typename _Tp>
+  static bool isUnique(const single_thread_shared_ptr<_Tp> &r) noexcept {
+    return r._counter.isUnique();
+  }
+
+  // drops the weak reference an object deriving from
+  // enable_single_thread_shared_from_this keeps to itself, for objects which
+  // outlive their last owner; the next owner sets a new one
+  template <typename _Tp> static void forgetOwners(_Tp &object) noexcept {
+    if constexpr (__sp_has_shared_from_this<_Tp>::value)
+      __enable_single_thread_shared_from_this_base(std::addressof(object))
+          ->_weak_this.reset();
+  }
+
+  template <typename _Tp, bool _ValueInit>
+  static single_thread_shared_ptr<_Tp> makeArray(std::size_t size) {
+    using block_type =
+        single_thread_shared_ptr_array_block<std::remove_extent_t<_Tp>>;
+    auto *block = block_type::template create<_ValueInit>(size);
+    SINGLE_THREAD_SHARED_PTR_RECORD(onCounterAllocation);
+    return adopt<_Tp>(block->ptr(), block);
+  }
+};
+
+/// Non owning reference to an object managed by single_thread_shared_ptr.
+/// The weak count lives in the heap counter, so the first weak pointer to a
+/// sole owner promotes its counter, pointers without weak references never
+/// pay for it.
+template <typename T> class single_thread_weak_ptr {
+private:
+  template <typename _Yp, typename _Res = void>
+  using _Compatible =
+      typename std::enable_if<__sp_compatible_with<_Yp *, T *>::value,
+                              _Res>::type;
+
+public:
+  using element_type = typename std::remove_extent_t<T>;
+  using trivially_relocatable = std::true_type;
+
+  constexpr single_thread_weak_ptr() noexcept
+      : _M_ptr{nullptr}, _block{nullptr} {}
+
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  single_thread_weak_ptr(const single_thread_shared_ptr<_Yp> &rhs)
+      : _M_ptr{rhs._M_ptr}, _block{rhs._counter.acquireWeak()} {}
+
+  single_thread_weak_ptr(const single_thread_weak_ptr &rhs) noexcept
+      : _M_ptr{rhs._M_ptr}, _block{acquire(rhs._block)} {}
+
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  single_thread_weak_ptr(const single_thread_weak_ptr<_Yp> &rhs) noexcept
+      : _M_ptr{rhs._M_ptr}, _block{acquire(rhs._block)} {}
+
+  single_thread_weak_ptr(single_thread_weak_ptr &&rhs) noexcept
+      : _M_ptr{std::exchange(rhs._M_ptr, nullptr)},
+        _block{std::exchange(rhs._block, nullptr)} {}
+
+  template <typename _Yp, typename = _Compatible<_Yp>>
+  single_thread_weak_ptr(single_thread_weak_ptr<_Yp> &&rhs) noexcept
+      : _M_ptr{std::exchange(rhs._M_ptr, nullptr)},
+        _block{std::exchange(rhs._block, nullptr)} {}
+
+  single_thread_weak_ptr &operator=(const single_thread_weak_ptr &rhs) noexcept {
+    single_thread_weak_ptr(rhs).swap(*this);
+    return *this;
+  }
+
+  single_thread_weak_ptr &operator=(single_thread_weak_ptr &&rhs) noexcept {
+    single_thread_weak_ptr(std::move(rhs)).swap(*this);
+    return *this;
+  }
+
+  template <typename _Yp>
+  _Compatible<_Yp, single_thread_weak_ptr &>
+  operator=(const single_thread_shared_ptr<_Yp> &rhs) {
+    single_thread_weak_ptr(rhs).swap(*this);
+    return *this;
+  }
+
+  ~single_thread_weak_ptr() noexcept {
+    if (_block) {
+      SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(_block, "weak release");
+      single_thread_shared_ptr_counter::releaseWeak(_block);
+    }
+  }
+
+  long use_count() const noexcept { return _block ? _block->_count : 0; }
+
+  bool expired() const noexcept { return use_count() == 0; }
+
+  single_thread_shared_ptr<T> lock() const noexcept {
+    return single_thread_shared_ptr<T>(
+        _M_ptr, single_thread_shared_ptr_counter::lock(_block));
+  }
+
+  void reset() noexcept { single_thread_weak_ptr{}.swap(*this); }
+
+  void swap(single_thread_weak_ptr &rhs) noexcept {
+    std::swap(_M_ptr, rhs._M_ptr);
+    std::swap(_block, rhs._block);
+  }
+
+  template <typename _Yp>
+  bool owner_before(const single_thread_weak_ptr<_Yp> &rhs) const noexcept {
+    return std::less<single_thread_shared_ptr_control_block *>()(_block,
+                                                                 rhs._block);
+  }
+
+  template <typename _Yp> friend class single_thread_weak_ptr;
+  template <typename _Yp> friend class single_thread_shared_ptr;
+  template <typename _Yp> friend class enable_single_thread_shared_from_this;
+
+private:
+  // weak reference to the object owned by counter, which is never empty
+  single_thread_weak_ptr(element_type *ptr,
+                         const single_thread_shared_ptr_counter &counter)
+      : _M_ptr{ptr}, _block{counter.acquireWeak()} {}
+
+  static single_thread_shared_ptr_control_block *
+  acquire(single_thread_shared_ptr_control_block *block) noexcept {
+    if (block) {
+      SINGLE_THREAD_SHARED_PTR_CHECK_THREAD(block, "weak copy");
+      ++block->_weak_count;
+    }
+    return block;
+  }
+
+  element_type *_M_ptr;
+  single_thread_shared_ptr_control_block *_block;
+};
+
+/// Base for objects which hand out owning pointers to themselves. The
+/// constructors of single_thread_shared_ptr give such objects a heap
+/// counter right away and remember it in a weak reference, so
+/// shared_from_this() only increments that count.
+template <typename _Tp> class enable_single_thread_shared_from_this {
+protected:
+  constexpr enable_single_thread_shared_from_this() noexcept {}
+
+  enable_single_thread_shared_from_this(
+      const enable_single_thread_shared_from_this &) noexcept {}
+
+  enable_single_thread_shared_from_this &
+  operator=(const enable_single_thread_shared_from_this &) noexcept {
+    return *this;
+  }
+
+  ~enable_single_thread_shared_from_this() = default;
+
+public:
+  // throws std::bad_weak_ptr when the object is not owned
+  single_thread_shared_ptr<_Tp> shared_from_this() {
+    return single_thread_shared_ptr<_Tp>(_weak_this);
+  }
+
+  single_thread_shared_ptr<const _Tp> shared_from_this() const {
+    return single_thread_shared_ptr<const _Tp>(_weak_this);
+  }
+
+  single_thread_weak_ptr<_Tp> weak_from_this() noexcept { return _weak_this; }
+
+  single_thread_weak_ptr<const _Tp> weak_from_this() const noexcept {
+    return _weak_this;
+  }
+
+private:
+  template <typename _Yp> friend class single_thread_shared_ptr;
+  friend struct single_thread_shared_ptr_factory;
+
+  friend const enable_single_thread_shared_from_this *
+  __enable_single_thread_shared_from_this_base(
+      const enable_single_thread_shared_from_this *__p) noexcept {
+    return __p;
+  }
+
+  // the first owner wins, later ones only take over an expired reference
+  template <typename _Yp>
+  void assignWeakThis(_Yp *ptr,
+                      const single_thread_shared_ptr_counter &counter) const {
+    if (_weak_this.expired())
+      _weak_this = single_thread_weak_ptr<_Tp>(
+          const_cast<_Tp *>(static_cast<const _Tp *>(ptr)), counter);
+  }
+
+  mutable single_thread_weak_ptr<_Tp> _weak_this;
+};
+
+/// Sole ownership of an object taken out of a single_thread_shared_ptr by
+/// release_to_thread(). Unlike the pointer it may be moved to another
+/// thread, where into_shared() makes it a single_thread_shared_ptr counted
+/// by that thread, or into_std_shared() a std::shared_ptr. The object is
+/// deleted with the handle otherwise.
+template <typename T> class single_thread_handoff {
+public:
+  using element_type = typename std::remove_extent_t<T>;
+
+  constexpr single_thread_handoff() noexcept
+      : _M_ptr{nullptr}, _block{nullptr} {}
+
+  single_thread_handoff(single_thread_handoff &&rhs) noexcept
+      : _M_ptr{std::exchange(rhs._M_ptr, nullptr)},
+        _block{std::exchange(rhs._block, nullptr)} {}
+
+  single_thread_handoff &operator=(single_thread_handoff &&rhs) noexcept {
+    single_thread_handoff(std::move(rhs)).swap(*this);
+    return *this;
+  }
+
+  ~single_thread_handoff() noexcept { destroy(); }
+
+  element_type *get() const noexcept { return _M_ptr; }
+
+  explicit operator bool() const noexcept { return _M_ptr == 0 ? false : true; }
+
+  void swap(single_thread_handoff &rhs) noexcept {
+    std::swap(_M_ptr, rhs._M_ptr);
+    std::swap(_block, rhs._block);
+  }
+
+  /// Owner on the calling thread, the handle is empty afterwards
+  single_thread_shared_ptr<T> into_shared() noexcept {
+    auto *ptr = std::exchange(_M_ptr, nullptr);
+    auto *block = std::exchange(_block, nullptr);
+    if (!block)
+      return single_thread_shared_ptr<T>(ptr);
+#if defined(SINGLE_THREAD_SHARED_PTR_THREAD_CHECK)
+    block->_owner = std::this_thread::get_id();
+#endif
+    return single_thread_shared_ptr_factory::adopt<T>(ptr, block);
+  }
+
+  /// Thread safe owner, the handle is empty afterwards. A co-allocated
+  /// object stays where it is, the std::shared_ptr releases its block.
+  std::shared_ptr<T> into_std_shared() {
+    auto *ptr = std::exchange(_M_ptr, nullptr);
+    auto *block = std::exchange(_block, nullptr);
+    if (!block)
+      return std::shared_ptr<T>(ptr);
+    return std::shared_ptr<T>(ptr, [block](element_type *) noexcept {
+      destroyBlock(block);
+    });
+  }
+
+  template <typename _Yp> friend class single_thread_shared_ptr;
+
+private:
+  single_thread_handoff(element_type *ptr,
+                        single_thread_shared_ptr_control_block *block) noexcept
+      : _M_ptr{ptr}, _block{block} {}
+
+  static void
+  destroyBlock(single_thread_shared_ptr_control_block *block) noexcept {
+    SINGLE_THREAD_SHARED_PTR_RECORD(onObjectDelete);
+    SINGLE_THREAD_SHARED_PTR_RECORD(onCounterFree);
+    block->_manager(block, single_thread_shared_ptr_block_op::dispose);
+    block->_manager(block, single_thread_shared_ptr_block_op::destroy);
+  }
+
+  void destroy() noexcept {
+    if (_block) {
+      destroyBlock(_block);
+    } else if (_M_ptr) {
+      SINGLE_THREAD_SHARED_PTR_RECORD(onObjectDelete);
+      if constexpr (std::is_array_v<T>)
+        delete[] _M_ptr;
+      else
+        delete _M_ptr;
+    }
+  }
+
+  element_type *_M_ptr;
+  single_thread_shared_ptr_control_block *_block;
+};
+
+/// Create an object that shares one allocation with its reference count, so
+/// copies of the returned pointer never allocate.
+template <typename _Tp, typename... _Args>
+inline std::enable_if_t<!std::is_array_v<_Tp>, single_thread_shared_ptr<_Tp>>
+make_single_thread_shared(_Args &&...__args) {
+  auto *block = new single_thread_shared_ptr_inplace_block<_Tp>(
+      std::forward<_Args>(__args)...);
+  SINGLE_THREAD_SHARED_PTR_RECORD(onCounterAllocation);
+  return single_thread_shared_ptr_factory::adopt<_Tp>(block->ptr(), block);
+}
+
+/// Array of size value initialized elements in one allocation with its
+/// reference count
+template <typename _Tp>
+inline std::enable_if_t<std::is_array_v<_Tp> && std::extent_v<_Tp> == 0,
+                        single_thread_shared_ptr<_Tp>>
+make_single_thread_shared(std::size_t size) {
+  return single_thread_shared_ptr_factory::makeArray<_Tp, true>(size);
+}
+
+/// Array of N value initialized elements in one allocation with its
+/// reference count
+template <typename _Tp>
+inline std::enable_if_t<std::extent_v<_Tp> != 0, single_thread_shared_ptr<_Tp>>
+make_single_thread_shared() {
+  return single_thread_shared_ptr_factory::makeArray<_Tp, true>(
+      std::extent_v<_Tp>);
+}
+
+/// Like make_single_thread_shared, but the elements are default initialized,
+/// so arrays of trivial types are not zeroed
+template <typename _Tp>
+inline std::enable_if_t<std::is_array_v<_Tp> && std::extent_v<_Tp> == 0,
+                        single_thread_shared_ptr<_Tp>>
+make_single_thread_shared_for_overwrite(std::size_t size) {
+  return single_thread_shared_ptr_factory::makeArray<_Tp, false>(size);
+}
+
+template <typename _Tp>
+inline std::enable_if_t<std::extent_v<_Tp> != 0, single_thread_shared_ptr<_Tp>>
+make_single_thread_shared_for_overwrite() {
+  return single_thread_shared_ptr_factory::makeArray<_Tp, false>(
+      std::extent_v<_Tp>);
+}
+
+/// Like make_single_thread_shared, but the object and its counter are
+/// allocated with the given allocator. A pointer to a std::pmr memory
+/// resource is accepted as well and used through a polymorphic_allocator.
+template <typename _Tp, typename _Alloc, typename... _Args>
+inline single_thread_shared_ptr<_Tp>
+allocate_single_thread_shared(const _Alloc &__a, _Args &&...__args) {
+  static_assert(!std::is_array_v<_Tp>, "arrays are not supported");
+  if constexpr (std::is_convertible_v<_Alloc, std::pmr::memory_resource *>) {
+    return allocate_single_thread_shared<_Tp>(
+        std::pmr::polymorphic_allocator<std::byte>{__a},
+        std::forward<_Args>(__args)...);
+  } else {
+    using block_type = single_thread_shared_ptr_alloc_block<_Tp, _Alloc>;
+    auto *block = block_type::create(__a, std::forward<_Args>(__args)...);
+    SINGLE_THREAD_SHARED_PTR_RECORD(onCounterAllocation);
+    return single_thread_shared_ptr_factory::adopt<_Tp>(block->ptr(), block);
+  }
+}
+
+/// Convert the stored pointer with static_cast, the result shares the
+/// count. The rvalue overloads take the count over instead of adding an
+/// owner.
+template <typename _Tp, typename _Up>
+inline single_thread_shared_ptr<_Tp>
+static_pointer_cast(const single_thread_shared_ptr<_Up> &__r) {
+  using _Sp = single_thread_shared_ptr<_Tp>;
+  return single_thread_shared_ptr_factory::convert<_Tp>(
+      __r, static_cast<typename _Sp::element_type *>(__r.get()));
+}
+
+template <typename _Tp, typename _Up>
+inline single_thread_shared_ptr<_Tp>
+static_pointer_cast(single_thread_shared_ptr<_Up> &&__r) noexcept {
+  using _Sp = single_thread_shared_ptr<_Tp>;
+  auto *__p = static_cast<typename _Sp::element_type *>(__r.get());
+  return single_thread_shared_ptr_factory::convert<_Tp>(std::move(__r), __p);
+}
+
+/// Convert the stored pointer with const_cast, the result shares the count
+template <typename _Tp, typename _Up>
+inline single_thread_shared_ptr<_Tp>
+const_pointer_cast(const single_thread_shared_ptr<_Up> &__r) {
+  using _Sp = single_thread_shared_ptr<_Tp>;
+  return single_thread_shared_ptr_factory::convert<_Tp>(
+      __r, const_cast<typename _Sp::element_type *>(__r.get()));
+}
+
+template <typename _Tp, typename _Up>
+inline single_thread_shared_ptr<_Tp>
+const_pointer_cast(single_thread_shared_ptr<_Up> &&__r) noexcept {
+  using _Sp = single_thread_shared_ptr<_Tp>;
+  auto *__p = const_cast<typename _Sp::element_type *>(__r.get());
+  return single_thread_shared_ptr_factory::convert<_Tp>(std::move(__r), __p);
+}
+
+/// Convert the stored pointer with dynamic_cast, empty when it fails. The
+/// rvalue overload leaves __r untouched then.
+template <typename _Tp, typename _Up>
+inline single_thread_shared_ptr<_Tp>
+dynamic_pointer_cast(const single_thread_shared_ptr<_Up> &__r) {
+  using _Sp = single_thread_shared_ptr<_Tp>;
+  return single_thread_shared_ptr_factory::convert<_Tp>(
+      __r, dynamic_cast<typename _Sp::element_type *>(__r.get()));
+}
+
+template <typename _Tp, typename _Up>
+inline single_thread_shared_ptr<_Tp>
+dynamic_pointer_cast(single_thread_shared_ptr<_Up> &&__r) noexcept {
+  using _Sp = single_thread_shared_ptr<_Tp>;
+  auto *__p = dynamic_cast<typename _Sp::element_type *>(__r.get());
+  return single_thread_shared_ptr_factory::convert<_Tp>(std::move(__r), __p);
+}
+
+/// Convert the stored pointer with reinterpret_cast. The object cannot be
+/// deleted through the result, so this is an alias of __r: a sole owner
+/// without a managed block allocates one.
+template <typename _Tp, typename _Up>
+inline single_thread_shared_ptr<_Tp>
+reinterpret_pointer_cast(const single_thread_shared_ptr<_Up> &__r) {
+  using _Sp = single_thread_shared_ptr<_Tp>;
+  return _Sp(__r, reinterpret_cast<typename _Sp::element_type *>(__r.get()));
+}
+
+template <typename _Tp, typename _Up>
+inline single_thread_shared_ptr<_Tp>
+reinterpret_pointer_cast(single_thread_shared_ptr<_Up> &&__r) {
+  using _Sp = single_thread_shared_ptr<_Tp>;
+  auto *__p = reinterpret_cast<typename _Sp::element_type *>(__r.get());
+  return _Sp(std::move(__r), __p);
+}
+
 /// Return true if the stored pointer is not null.
 /// Equality operator for shared_ptr objects, compares the stored pointers
 template <typename _Tp, typename _Up>
@@ -376,13 +1960,81 @@ operator>=(std::nullptr_t, const single_thread_shared_ptr<_Tp> &__a) noexcept {
   return !(nullptr < __a);
 }
 
-namespace std {
+/// Non owning pointer for looking up ptr in containers of
+/// single_thread_shared_ptr: an alias of an empty pointer, it has no count
+/// and never deletes the object
 template <typename _Tp>
-struct hash<single_thread_shared_ptr<_Tp>>
-    : public __hash_base<size_t, single_thread_shared_ptr<_Tp>> {
+inline single_thread_shared_ptr<_Tp> single_thread_lookup_key(_Tp *ptr) noexcept {
+  return single_thread_shared_ptr<_Tp>(single_thread_shared_ptr<_Tp>(), ptr);
+}
+
+// Stored pointer of a single_thread_shared_ptr or a raw pointer, as the
+// const pointer the transparent functors below compare and hash
+template <typename _Tp> struct __sp_lookup_key {
+  using pointer = const volatile typename single_thread_shared_ptr<_Tp>::element_type *;
+
+  static pointer get(pointer __p) noexcept { return __p; }
+
+  template <typename _Yp>
+  static pointer get(const single_thread_shared_ptr<_Yp> &__p) noexcept {
+    return __p.get();
+  }
+};
+
+/// Transparent hash for unordered containers of single_thread_shared_ptr<T>:
+/// lookups with a raw pointer neither build a temporary owner nor touch a
+/// count. Hashes like std::hash<single_thread_shared_ptr<T>>. Unordered
+/// containers accept other key types from C++20 on, before that look up
+/// single_thread_lookup_key(ptr).
+template <typename _Tp> struct single_thread_shared_ptr_hash {
+  using is_transparent = void;
+
+  template <typename _Ap>
+  std::size_t operator()(const _Ap &__a) const noexcept {
+    using _Key = __sp_lookup_key<_Tp>;
+    return std::hash<typename _Key::pointer>()(_Key::get(__a));
+  }
+};
+
+/// Transparent equality matching single_thread_shared_ptr_hash, compares the
+/// stored pointers like operator==
+template <typename _Tp> struct single_thread_shared_ptr_equal {
+  using is_transparent = void;
+
+  template <typename _Ap, typename _Bp>
+  bool operator()(const _Ap &__a, const _Bp &__b) const noexcept {
+    using _Key = __sp_lookup_key<_Tp>;
+    return _Key::get(__a) == _Key::get(__b);
+  }
+};
+
+/// Transparent ordering for std::set / std::map keyed by
+/// single_thread_shared_ptr<T>, compares with operator< and raw pointers as
+/// single_thread_lookup_key(ptr), which has no count to touch
+template <typename _Tp> struct single_thread_shared_ptr_less {
+  using is_transparent = void;
+
+  template <typename _Ap, typename _Bp>
+  bool operator()(const _Ap &__a, const _Bp &__b) const noexcept {
+    return key(__a) < key(__b);
+  }
+
+private:
+  template <typename _Yp>
+  static const single_thread_shared_ptr<_Yp> &
+  key(const single_thread_shared_ptr<_Yp> &__p) noexcept {
+    return __p;
+  }
+
+  static auto key(typename __sp_lookup_key<_Tp>::pointer __p) noexcept {
+    return single_thread_lookup_key(__p);
+  }
+};
+
+namespace std {
+template <typename _Tp> struct hash<single_thread_shared_ptr<_Tp>> {
   size_t operator()(const single_thread_shared_ptr<_Tp> &s) const noexcept {
-    return std::hash<typename single_thread_shared_ptr<_Tp>::element_type *>()(
-        s.get());
+    return single_thread_shared_ptr_hash<_Tp>()(s);
   }
 };
 } // namespace std
@@ -0,0 +1,142 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <array>
+#include <memory_resource>
+#include <vector>
+
+namespace {
+struct A {
+  A() { ++ctor_count; }
+  A(int v) : value{v} { ++ctor_count; }
+  ~A() { ++dtor_count; }
+  int value{0};
+  static long ctor_count;
+  static long dtor_count;
+};
+long A::ctor_count = 0;
+long A::dtor_count = 0;
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    A::ctor_count = 0;
+    A::dtor_count = 0;
+  }
+};
+
+struct allocation_stats {
+  long allocations{0};
+  long deallocations{0};
+};
+
+template <typename T> struct counting_allocator {
+  using value_type = T;
+
+  explicit counting_allocator(allocation_stats &s) : stats{&s} {}
+  template <typename U>
+  counting_allocator(const counting_allocator<U> &rhs) : stats{rhs.stats} {}
+
+  T *allocate(std::size_t n) {
+    ++stats->allocations;
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T *p, std::size_t n) {
+    ++stats->deallocations;
+    std::allocator<T>{}.deallocate(p, n);
+  }
+
+  template <typename U> bool operator==(const counting_allocator<U> &rhs) const {
+    return stats == rhs.stats;
+  }
+  template <typename U> bool operator!=(const counting_allocator<U> &rhs) const {
+    return stats != rhs.stats;
+  }
+
+  allocation_stats *stats;
+};
+
+struct throws_on_construction {
+  throws_on_construction() { throw 1; }
+};
+
+struct uses_pmr {
+  using allocator_type = std::pmr::polymorphic_allocator<int>;
+  explicit uses_pmr(const allocator_type &alloc) : values{alloc} {}
+  std::pmr::vector<int> values;
+};
+} // namespace
+
+TEST_CASE("allocate_single_thread_shared uses the given allocator") {
+  reset_count_struct __attribute__((unused)) reset;
+  allocation_stats stats;
+  counting_allocator<A> alloc{stats};
+
+  SECTION("Object and counter share one allocation") {
+    auto p = allocate_single_thread_shared<A>(alloc, 7);
+    REQUIRE(p->value == 7);
+    REQUIRE(p.use_count() == 1);
+    REQUIRE(stats.allocations == 1);
+  }
+
+  SECTION("Copies use the same block") {
+    auto p1 = allocate_single_thread_shared<A>(alloc);
+    {
+      auto p2 = p1;
+      auto p3 = p2;
+      REQUIRE(p1.use_count() == 3);
+    }
+    REQUIRE(stats.allocations == 1);
+    REQUIRE(stats.deallocations == 0);
+    REQUIRE(A::dtor_count == 0);
+  }
+
+  SECTION("Last owner returns the memory to the allocator") {
+    { auto p = allocate_single_thread_shared<A>(alloc); }
+    REQUIRE(A::dtor_count == 1);
+    REQUIRE(stats.deallocations == 1);
+  }
+
+  SECTION("Memory is returned when the constructor throws") {
+    counting_allocator<throws_on_construction> a{stats};
+    REQUIRE_THROWS(allocate_single_thread_shared<throws_on_construction>(a));
+    REQUIRE(stats.allocations == 1);
+    REQUIRE(stats.deallocations == 1);
+  }
+
+  REQUIRE(A::ctor_count == A::dtor_count);
+}
+
+TEST_CASE("allocate_single_thread_shared works with std::pmr") {
+  reset_count_struct __attribute__((unused)) reset;
+  std::array<std::byte, 4096> buffer;
+  std::pmr::monotonic_buffer_resource arena{buffer.data(), buffer.size(),
+                                            std::pmr::null_memory_resource()};
+  auto in_arena = [&](const void *p) {
+    auto *b = static_cast<const std::byte *>(p);
+    return b >= buffer.data() && b < buffer.data() + buffer.size();
+  };
+
+  SECTION("Memory resource pointer") {
+    auto p = allocate_single_thread_shared<A>(&arena, 3);
+    REQUIRE(in_arena(p.get()));
+    auto copy = p;
+    REQUIRE(copy.use_count() == 2);
+  }
+
+  SECTION("Polymorphic allocator") {
+    std::pmr::polymorphic_allocator<A> alloc{&arena};
+    auto p = allocate_single_thread_shared<A>(alloc);
+    REQUIRE(in_arena(p.get()));
+  }
+
+  SECTION("Allocator is propagated to the object") {
+    auto p = allocate_single_thread_shared<uses_pmr>(&arena);
+    p->values.push_back(1);
+    REQUIRE(in_arena(p.get()));
+    REQUIRE(in_arena(p->values.data()));
+  }
+
+  REQUIRE(A::ctor_count == A::dtor_count);
+}
@@ -0,0 +1,158 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <cstdint>
+#include <type_traits>
+
+namespace {
+struct A {
+  A() { ++ctor_count; }
+  ~A() { ++dtor_count; }
+  int value{7};
+  static long ctor_count;
+  static long dtor_count;
+};
+long A::ctor_count = 0;
+long A::dtor_count = 0;
+
+struct Throwing {
+  Throwing() {
+    if (ctor_count == throw_at)
+      throw 1;
+    ++ctor_count;
+  }
+  ~Throwing() { ++dtor_count; }
+  static long ctor_count;
+  static long dtor_count;
+  static long throw_at;
+};
+long Throwing::ctor_count = 0;
+long Throwing::dtor_count = 0;
+long Throwing::throw_at = -1;
+
+struct alignas(64) Overaligned {
+  char c;
+};
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    A::ctor_count = 0;
+    A::dtor_count = 0;
+    Throwing::ctor_count = 0;
+    Throwing::dtor_count = 0;
+    Throwing::throw_at = -1;
+  }
+};
+} // namespace
+
+static_assert(std::is_same_v<single_thread_shared_ptr<int[]>::element_type, int>);
+static_assert(std::is_same_v<single_thread_shared_ptr<int[4]>::element_type, int>);
+static_assert(std::is_convertible_v<single_thread_shared_ptr<int[4]>,
+                                    single_thread_shared_ptr<int[]>>);
+static_assert(std::is_convertible_v<single_thread_shared_ptr<int[]>,
+                                    single_thread_shared_ptr<const int[]>>);
+static_assert(!std::is_convertible_v<single_thread_shared_ptr<int[]>,
+                                     single_thread_shared_ptr<int[4]>>);
+static_assert(!std::is_constructible_v<single_thread_shared_ptr<A[]>, A *,
+                                       void *>);
+
+TEST_CASE("Array pointers own arrays created with new[]") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Unbounded array") {
+    {
+      single_thread_shared_ptr<A[]> p(new A[3]);
+      REQUIRE(A::ctor_count == 3);
+      REQUIRE(p[2].value == 7);
+      auto q = p;
+      REQUIRE(q.use_count() == 2);
+    }
+    REQUIRE(A::dtor_count == 3);
+  }
+
+  SECTION("Bounded array") {
+    {
+      single_thread_shared_ptr<A[2]> p(new A[2]);
+      p[1].value = 1;
+      single_thread_shared_ptr<A[]> q = p;
+      REQUIRE(q[1].value == 1);
+    }
+    REQUIRE(A::dtor_count == 2);
+  }
+
+  SECTION("Reset and assignment release with delete[]") {
+    single_thread_shared_ptr<A[]> p(new A[2]);
+    p.reset(new A[4]);
+    REQUIRE(A::dtor_count == 2);
+    p = single_thread_shared_ptr<A[]>(new A[1]);
+    REQUIRE(A::dtor_count == 6);
+    p.reset();
+    REQUIRE(A::dtor_count == 7);
+  }
+}
+
+TEST_CASE("make_single_thread_shared creates arrays") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Elements are value initialized") {
+    auto p = make_single_thread_shared<int[]>(16);
+    for (int i = 0; i < 16; ++i)
+      REQUIRE(p[i] == 0);
+    auto q = make_single_thread_shared<double[8]>();
+    for (int i = 0; i < 8; ++i)
+      REQUIRE(q[i] == 0.0);
+  }
+
+  SECTION("Elements are constructed and destroyed once") {
+    {
+      auto p = make_single_thread_shared<A[]>(5);
+      REQUIRE(A::ctor_count == 5);
+      auto q = p;
+      REQUIRE(p.use_count() == 2);
+    }
+    REQUIRE(A::dtor_count == 5);
+  }
+
+  SECTION("Empty array") {
+    auto p = make_single_thread_shared<A[]>(0);
+    REQUIRE(p.get() != nullptr);
+    REQUIRE(p.use_count() == 1);
+  }
+
+  SECTION("For overwrite still constructs class types") {
+    {
+      auto p = make_single_thread_shared_for_overwrite<A[]>(3);
+      REQUIRE(A::ctor_count == 3);
+      auto q = make_single_thread_shared_for_overwrite<unsigned char[64]>();
+      q[63] = 1;
+      REQUIRE(q[63] == 1);
+    }
+    REQUIRE(A::dtor_count == 3);
+  }
+
+  SECTION("Constructed elements are destroyed when one throws") {
+    Throwing::throw_at = 3;
+    REQUIRE_THROWS(make_single_thread_shared<Throwing[]>(5));
+    REQUIRE(Throwing::ctor_count == 3);
+    REQUIRE(Throwing::dtor_count == 3);
+  }
+
+  SECTION("Elements are suitably aligned") {
+    auto p = make_single_thread_shared<Overaligned[]>(3);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(p.get()) % 64 == 0);
+    auto q = make_single_thread_shared<long double[]>(3);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(q.get()) % alignof(long double) ==
+            0);
+  }
+
+  SECTION("Weak pointers keep the storage, not the elements") {
+    single_thread_weak_ptr<A[]> w;
+    {
+      auto p = make_single_thread_shared<A[]>(2);
+      w = p;
+    }
+    REQUIRE(A::dtor_count == 2);
+    REQUIRE(w.expired());
+  }
+}
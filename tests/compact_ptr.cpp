@@ -0,0 +1,145 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_compact_ptr.hpp>
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+struct A {
+  A() { ++ctor_count; }
+  explicit A(int v) : value{v} { ++ctor_count; }
+  ~A() { ++dtor_count; }
+  int value{0};
+  static long ctor_count;
+  static long dtor_count;
+};
+long A::ctor_count = 0;
+long A::dtor_count = 0;
+
+struct Throwing {
+  Throwing() { throw 1; }
+};
+
+struct alignas(64) Overaligned {
+  char c;
+};
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    A::ctor_count = 0;
+    A::dtor_count = 0;
+  }
+};
+} // namespace
+
+static_assert(sizeof(single_thread_compact_ptr<A>) == sizeof(void *),
+              "compact pointer is one word");
+static_assert(sizeof(single_thread_compact_ptr<Overaligned>) == sizeof(void *),
+              "compact pointer is one word");
+static_assert(std::is_convertible_v<single_thread_compact_ptr<A>,
+                                    single_thread_compact_ptr<const A>>);
+static_assert(!std::is_convertible_v<single_thread_compact_ptr<const A>,
+                                     single_thread_compact_ptr<A>>);
+static_assert(!std::is_constructible_v<single_thread_compact_ptr<A>, A *>,
+              "only make_single_thread_compact creates owners");
+
+TEST_CASE("single_thread_compact_ptr ownership") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Empty pointer") {
+    single_thread_compact_ptr<A> p;
+    REQUIRE(p.get() == nullptr);
+    REQUIRE(p.use_count() == 0);
+    REQUIRE(!p);
+    REQUIRE(p == nullptr);
+  }
+
+  SECTION("Arguments are forwarded to the constructor") {
+    auto p = make_single_thread_compact<A>(42);
+    REQUIRE(p->value == 42);
+    REQUIRE((*p).value == 42);
+    REQUIRE(p.use_count() == 1);
+  }
+
+  SECTION("Copies share the count") {
+    {
+      auto p = make_single_thread_compact<A>(1);
+      auto c = p;
+      REQUIRE(p.use_count() == 2);
+      REQUIRE(c == p);
+      single_thread_compact_ptr<A> a;
+      a = c;
+      REQUIRE(p.use_count() == 3);
+      c.reset();
+      REQUIRE(p.use_count() == 2);
+    }
+    REQUIRE(A::ctor_count == 1);
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Moves do not touch the count") {
+    auto p = make_single_thread_compact<A>(1);
+    auto m = std::move(p);
+    REQUIRE(!p);
+    REQUIRE(m.use_count() == 1);
+    p = std::move(m);
+    REQUIRE(p.use_count() == 1);
+    p = std::move(p);
+    REQUIRE(p.use_count() == 1);
+  }
+
+  SECTION("Self assignment") {
+    auto p = make_single_thread_compact<A>(1);
+    auto &alias = p;
+    p = alias;
+    REQUIRE(p.use_count() == 1);
+    REQUIRE(A::dtor_count == 0);
+  }
+
+  SECTION("Conversion to const") {
+    auto p = make_single_thread_compact<A>(3);
+    single_thread_compact_ptr<const A> c = p;
+    REQUIRE(c->value == 3);
+    REQUIRE(p.use_count() == 2);
+    single_thread_compact_ptr<const A> m = std::move(p);
+    REQUIRE(c.use_count() == 2);
+  }
+
+  SECTION("Const object") {
+    { auto p = make_single_thread_compact<const A>(2); }
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Failed construction releases the memory") {
+    REQUIRE_THROWS(make_single_thread_compact<Throwing>());
+  }
+
+  SECTION("Objects are suitably aligned") {
+    auto p = make_single_thread_compact<Overaligned>();
+    REQUIRE(reinterpret_cast<std::uintptr_t>(p.get()) % 64 == 0);
+    auto d = make_single_thread_compact<long double>(1.0L);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(d.get()) % alignof(long double) ==
+            0);
+  }
+}
+
+TEST_CASE("single_thread_compact_ptr in containers") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  {
+    std::vector<single_thread_compact_ptr<A>> v;
+    for (int i = 0; i < 100; ++i)
+      v.push_back(make_single_thread_compact<A>(i));
+    auto copy = v;
+    REQUIRE(v[7].use_count() == 2);
+
+    std::unordered_set<single_thread_compact_ptr<A>> set(v.begin(), v.end());
+    REQUIRE(set.size() == 100);
+    REQUIRE(set.count(copy[42]) == 1);
+    REQUIRE(!(v[0] < v[0]));
+    REQUIRE((v[0] <= v[0]));
+  }
+  REQUIRE(A::dtor_count == 100);
+}
@@ -2,6 +2,9 @@
 
 #include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
 
+#include <set>
+#include <vector>
+
 namespace {
 struct A {
   virtual ~A() {}
@@ -144,3 +147,32 @@ TEST_CASE("single_thread_shared_ptr comparision operators works") {
     REQUIRE((less(p1, p2) || less(p2, p1)));
   }
 }
+
+TEST_CASE("single_thread_shared_ptr_less supports raw pointer lookup") {
+  using set_type =
+      std::set<single_thread_shared_ptr<A>, single_thread_shared_ptr_less<A>>;
+
+  set_type set;
+  std::vector<A *> raw;
+  for (int i = 0; i < 10; ++i) {
+    single_thread_shared_ptr<A> p(new B);
+    raw.push_back(p.get());
+    set.insert(p);
+  }
+
+  for (auto *p : raw) {
+    auto it = set.find(p);
+    REQUIRE(it != set.end());
+    REQUIRE(it->get() == p);
+    REQUIRE(it->use_count() == 1);
+  }
+
+  single_thread_shared_ptr_less<A> less;
+  auto first = *set.begin();
+  auto second = *std::next(set.begin());
+  REQUIRE(less(first, second) == (first < second));
+  REQUIRE(less(first.get(), second) == (first < second));
+  REQUIRE(less(first, second.get()) == (first < second));
+  REQUIRE(!less(first, first.get()));
+  REQUIRE(set.lower_bound(raw[0])->get() == raw[0]);
+}
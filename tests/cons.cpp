@@ -21,12 +21,22 @@ struct B : A {
 long B::ctor_count = 0;
 long B::dtor_count = 0;
 
+struct D {
+  void operator()(B *p) const {
+    delete p;
+    ++delete_count;
+  }
+  static long delete_count;
+};
+long D::delete_count = 0;
+
 struct reset_count_struct {
   ~reset_count_struct() {
     A::ctor_count = 0;
     A::dtor_count = 0;
     B::ctor_count = 0;
     B::dtor_count = 0;
+    D::delete_count = 0;
   }
 };
 
@@ -104,20 +114,20 @@ TEST_CASE("single_thread_shared_ptr can be constructed by move") {
     single_thread_shared_ptr<int> x{data};
   }
 
-  //    SECTION("Move pointer with user defined destructor"){
-  //        single_thread_shared_ptr<B> b(new B, D());
-  //        single_thread_shared_ptr<A> a(std::move(b));
-  //        REQUIRE( b.use_count() == 0 );
-  //        REQUIRE( a.use_count() == 1 );
-  //        REQUIRE( A::ctor_count == 1 );
-  //        REQUIRE( A::dtor_count == 0 );
-  //        REQUIRE( B::ctor_count == 1 );
-  //        REQUIRE( B::dtor_count == 0 );
-
-  //        a = std::move(single_thread_shared_ptr<A>());
-  //        REQUIRE( D::delete_count == 1 );
-  //        REQUIRE( B::dtor_count == 1 );
-  //    }
+  SECTION("Move pointer with user defined destructor") {
+    single_thread_shared_ptr<B> b(new B, D());
+    single_thread_shared_ptr<A> a(std::move(b));
+    REQUIRE(b.use_count() == 0);
+    REQUIRE(a.use_count() == 1);
+    REQUIRE(A::ctor_count == 1);
+    REQUIRE(A::dtor_count == 0);
+    REQUIRE(B::ctor_count == 1);
+    REQUIRE(B::dtor_count == 0);
+
+    a = std::move(single_thread_shared_ptr<A>());
+    REQUIRE(D::delete_count == 1);
+    REQUIRE(B::dtor_count == 1);
+  }
 
   SECTION("Rvalue construction") {
     single_thread_shared_ptr<A> a(
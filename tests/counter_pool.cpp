@@ -0,0 +1,45 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <thread>
+
+using pool = single_thread_shared_ptr_counter_pool;
+
+TEST_CASE("single_thread_shared_ptr_counter_pool reuses released cells") {
+  pool::trim();
+
+  SECTION("Released cell is handed out again") {
+    void *c1 = pool::allocate();
+    pool::deallocate(c1);
+    REQUIRE(pool::size() == 1);
+
+    void *c2 = pool::allocate();
+    REQUIRE(c2 == c1);
+    REQUIRE(pool::size() == 0);
+    pool::deallocate(c2);
+  }
+
+  SECTION("Trim empties the free list") {
+    pool::deallocate(pool::allocate());
+    REQUIRE(pool::size() == 1);
+    pool::trim();
+    REQUIRE(pool::size() == 0);
+  }
+
+  SECTION("Free lists are per thread") {
+    pool::deallocate(pool::allocate());
+    std::size_t other = 1;
+    std::thread([&] { other = pool::size(); }).join();
+    REQUIRE(other == 0);
+    REQUIRE(pool::size() == 1);
+  }
+
+  SECTION("Cell can be released on another thread") {
+    void *c = pool::allocate();
+    std::thread([&] { pool::deallocate(c); }).join();
+    REQUIRE(pool::size() == 0);
+  }
+
+  pool::trim();
+}
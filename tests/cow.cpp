@@ -0,0 +1,170 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_cow.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+struct Config {
+  Config() { ++ctor_count; }
+  Config(const Config &rhs) : name{rhs.name}, values{rhs.values} {
+    if (fail_copy)
+      throw std::runtime_error("copy failed");
+    ++copy_count;
+  }
+  Config &operator=(const Config &) = default;
+  ~Config() { ++dtor_count; }
+
+  std::string name;
+  std::vector<int> values;
+  static long ctor_count;
+  static long copy_count;
+  static long dtor_count;
+  static bool fail_copy;
+};
+long Config::ctor_count = 0;
+long Config::copy_count = 0;
+long Config::dtor_count = 0;
+bool Config::fail_copy = false;
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    Config::ctor_count = 0;
+    Config::copy_count = 0;
+    Config::dtor_count = 0;
+    Config::fail_copy = false;
+  }
+};
+} // namespace
+
+TEST_CASE("single_thread_cow copies on write") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Writes to a value nobody shares happen in place") {
+    single_thread_cow<Config> c;
+    const Config *before = c.operator->();
+    REQUIRE(c.unique());
+    c.write().name = "base";
+    c.update([](Config &v) { v.values.push_back(1); });
+    REQUIRE(c.operator->() == before);
+    REQUIRE(c->name == "base");
+    REQUIRE(Config::copy_count == 0);
+  }
+
+  SECTION("Copies share the object until one of them writes") {
+    single_thread_cow<Config> base;
+    base.write().name = "base";
+    auto overlay = base;
+    REQUIRE(overlay.operator->() == base.operator->());
+    REQUIRE(base.use_count() == 2);
+    REQUIRE(!base.unique());
+    REQUIRE(Config::copy_count == 0);
+
+    overlay.write().name = "overlay";
+    REQUIRE(Config::copy_count == 1);
+    REQUIRE(base->name == "base");
+    REQUIRE(overlay->name == "overlay");
+    REQUIRE(base.unique());
+    REQUIRE(overlay.unique());
+
+    overlay.write().values.push_back(2);
+    REQUIRE(Config::copy_count == 1);
+  }
+
+  SECTION("update runs all its writes on one copy") {
+    single_thread_cow<Config> base;
+    auto overlay = base;
+    auto size = overlay.update([](Config &v) {
+      v.name = "overlay";
+      for (int i = 0; i < 10; ++i)
+        v.values.push_back(i);
+      return v.values.size();
+    });
+    REQUIRE(size == 10);
+    REQUIRE(Config::copy_count == 1);
+    REQUIRE(base->values.empty());
+  }
+
+  SECTION("The last copy writes in place again") {
+    single_thread_cow<Config> base;
+    {
+      auto copy = base;
+      REQUIRE(!base.unique());
+    }
+    REQUIRE(base.unique());
+    base.write().name = "base";
+    REQUIRE(Config::copy_count == 0);
+  }
+
+  SECTION("Snapshots keep the value they were taken of") {
+    single_thread_cow<Config> c;
+    c.write().name = "first";
+    auto snapshot = c.snapshot();
+    c.write().name = "second";
+    REQUIRE(snapshot->name == "first");
+    REQUIRE(c->name == "second");
+    REQUIRE(Config::copy_count == 1);
+  }
+
+  SECTION("Weak observers do not see writes") {
+    single_thread_cow<Config> c;
+    c.write().name = "first";
+    single_thread_weak_ptr<const Config> weak;
+    {
+      auto snapshot = c.snapshot();
+      weak = snapshot;
+    }
+    REQUIRE(!c.unique());
+    c.write().name = "second";
+    REQUIRE(weak.expired());
+    REQUIRE(c.unique());
+  }
+
+  SECTION("Assigning a value reuses an object nobody shares") {
+    Config value;
+    value.name = "assigned";
+    single_thread_cow<Config> c;
+    const Config *before = c.operator->();
+    c = value;
+    REQUIRE(c.operator->() == before);
+    REQUIRE(c->name == "assigned");
+
+    auto copy = c;
+    value.name = "again";
+    c = value;
+    REQUIRE(c->name == "again");
+    REQUIRE(copy->name == "assigned");
+  }
+
+  SECTION("A failed copy leaves the shared value unchanged") {
+    single_thread_cow<Config> base;
+    base.write().name = "base";
+    auto overlay = base;
+    Config::fail_copy = true;
+    REQUIRE_THROWS_AS(overlay.write(), std::runtime_error);
+    REQUIRE(overlay.operator->() == base.operator->());
+    REQUIRE(overlay.use_count() == 2);
+  }
+
+  SECTION("Existing objects can be wrapped") {
+    auto p = make_single_thread_shared<Config>();
+    auto *raw = p.get();
+    single_thread_cow<Config> c(std::move(p));
+    c.write().name = "wrapped";
+    REQUIRE(c.operator->() == raw);
+    REQUIRE(Config::copy_count == 0);
+  }
+
+  SECTION("Every object is destroyed") {
+    {
+      single_thread_cow<Config> a;
+      auto b = a;
+      b.write();
+      auto c = std::move(b);
+      a.swap(c);
+    }
+    REQUIRE(Config::ctor_count + Config::copy_count == Config::dtor_count);
+  }
+}
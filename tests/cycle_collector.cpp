@@ -0,0 +1,158 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_cycle_collector.hpp>
+
+#include <vector>
+
+namespace {
+struct Node {
+  explicit Node(int v = 0) : value{v} { ++alive; }
+  ~Node() { --alive; }
+
+  void trace(single_thread_cycle_visitor &visit) const {
+    visit(next);
+    for (auto &child : children)
+      visit(child);
+  }
+
+  int value;
+  single_thread_shared_ptr<Node> next;
+  std::vector<single_thread_shared_ptr<Node>> children;
+  static long alive;
+};
+long Node::alive = 0;
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    single_thread_cycle_collector::collect();
+    Node::alive = 0;
+  }
+};
+} // namespace
+
+TEST_CASE("Cycle collector destroys garbage cycles") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Object owning itself") {
+    auto a = make_single_thread_collectible<Node>();
+    a->next = a;
+    a.reset();
+    REQUIRE(Node::alive == 1);
+    REQUIRE(single_thread_cycle_collector::size() == 1);
+    REQUIRE(single_thread_cycle_collector::collect() == 1);
+    REQUIRE(Node::alive == 0);
+    REQUIRE(single_thread_cycle_collector::size() == 0);
+  }
+
+  SECTION("Parent and child") {
+    auto parent = make_single_thread_collectible<Node>();
+    auto child = make_single_thread_collectible<Node>();
+    parent->children.push_back(child);
+    child->next = parent;
+    parent.reset();
+    child.reset();
+    REQUIRE(Node::alive == 2);
+    REQUIRE(single_thread_cycle_collector::collect() == 2);
+    REQUIRE(Node::alive == 0);
+  }
+
+  SECTION("Cycles referenced from outside survive with their counts") {
+    auto parent = make_single_thread_collectible<Node>(1);
+    auto child = make_single_thread_collectible<Node>(2);
+    parent->children.push_back(child);
+    child->next = parent;
+    parent.reset();
+    REQUIRE(single_thread_cycle_collector::collect() == 0);
+    REQUIRE(Node::alive == 2);
+    REQUIRE(child.use_count() == 2);
+    REQUIRE(child->next.use_count() == 1);
+    REQUIRE(child->next->value == 1);
+
+    child.reset();
+    REQUIRE(single_thread_cycle_collector::collect() == 2);
+    REQUIRE(Node::alive == 0);
+  }
+
+  SECTION("Objects in use referenced by a garbage cycle keep living") {
+    auto shared = make_single_thread_collectible<Node>(7);
+    {
+      auto a = make_single_thread_collectible<Node>();
+      auto b = make_single_thread_collectible<Node>();
+      a->next = b;
+      b->next = a;
+      a->children.push_back(shared);
+      b->children.push_back(shared);
+    }
+    REQUIRE(shared.use_count() == 3);
+    REQUIRE(single_thread_cycle_collector::collect() == 2);
+    REQUIRE(Node::alive == 1);
+    REQUIRE(shared.use_count() == 1);
+    REQUIRE(shared->value == 7);
+  }
+
+  SECTION("Weak pointers to collected objects expire") {
+    single_thread_weak_ptr<Node> w;
+    {
+      auto a = make_single_thread_collectible<Node>();
+      a->next = a;
+      w = a;
+    }
+    REQUIRE(!w.expired());
+    single_thread_cycle_collector::collect();
+    REQUIRE(w.expired());
+    REQUIRE(!w.lock());
+  }
+
+  SECTION("Released candidates are dropped from the buffer") {
+    auto a = make_single_thread_collectible<Node>();
+    { auto copy = a; }
+    REQUIRE(single_thread_cycle_collector::size() == 1);
+    a.reset();
+    REQUIRE(Node::alive == 0);
+    REQUIRE(single_thread_cycle_collector::collect() == 0);
+    REQUIRE(single_thread_cycle_collector::size() == 0);
+  }
+
+  SECTION("Long rings are collected without recursion") {
+    constexpr int length = 100000;
+    {
+      auto first = make_single_thread_collectible<Node>(0);
+      auto last = first;
+      for (int i = 1; i < length; ++i) {
+        auto node = make_single_thread_collectible<Node>(i);
+        last->next = node;
+        last = node;
+      }
+      last->next = first;
+    }
+    REQUIRE(Node::alive == length);
+    REQUIRE(single_thread_cycle_collector::collect() == length);
+    REQUIRE(Node::alive == 0);
+  }
+
+  SECTION("A full buffer is collected by the next allocation") {
+    auto previous = single_thread_cycle_collector::threshold();
+    single_thread_cycle_collector::setThreshold(2);
+    for (int i = 0; i < 2; ++i) {
+      auto a = make_single_thread_collectible<Node>();
+      a->next = a;
+    }
+    REQUIRE(single_thread_cycle_collector::size() == 2);
+    REQUIRE(Node::alive == 2);
+    auto fresh = make_single_thread_collectible<Node>();
+    REQUIRE(Node::alive == 1);
+    REQUIRE(single_thread_cycle_collector::size() == 0);
+    single_thread_cycle_collector::setThreshold(previous);
+  }
+
+  SECTION("Cycles through objects which are not collectible are kept") {
+    auto a = make_single_thread_collectible<Node>();
+    auto plain = make_single_thread_shared<Node>();
+    a->next = plain;
+    plain->next = a;
+    a.reset();
+    REQUIRE(single_thread_cycle_collector::collect() == 0);
+    REQUIRE(Node::alive == 2);
+    plain->next.reset();
+  }
+}
@@ -0,0 +1,147 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// built into its own executable with SINGLE_THREAD_SHARED_PTR_DEFERRED_DELETE
+static_assert(single_thread_shared_ptr_reclamation::enabled,
+              "deferred delete is enabled for this test");
+
+using reclamation = single_thread_shared_ptr_reclamation;
+
+namespace {
+struct A {
+  A() = default;
+  explicit A(int v) : value{v} {}
+  ~A() { ++dtor_count; }
+  int value{0};
+  static long dtor_count;
+};
+long A::dtor_count = 0;
+
+struct Node {
+  ~Node() { ++dtor_count; }
+  std::vector<single_thread_shared_ptr<Node>> children;
+  static long dtor_count;
+};
+long Node::dtor_count = 0;
+
+single_thread_shared_ptr<Node> chain(int length) {
+  auto head = make_single_thread_shared<Node>();
+  auto *tail = head.get();
+  for (int i = 1; i < length; ++i) {
+    tail->children.push_back(make_single_thread_shared<Node>());
+    tail = tail->children.back().get();
+  }
+  return head;
+}
+
+struct reset_count_struct {
+  reset_count_struct() { reclamation::drain(); }
+  ~reset_count_struct() {
+    reclamation::drain();
+    A::dtor_count = 0;
+    Node::dtor_count = 0;
+  }
+};
+} // namespace
+
+TEST_CASE("Last owners queue their objects") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Object owned through a raw pointer") {
+    { single_thread_shared_ptr<A> p(new A); }
+    REQUIRE(A::dtor_count == 0);
+    REQUIRE(reclamation::size() == 1);
+    REQUIRE(reclamation::drain() == 1);
+    REQUIRE(A::dtor_count == 1);
+    REQUIRE(reclamation::size() == 0);
+  }
+
+  SECTION("Co-allocated object") {
+    single_thread_weak_ptr<A> w;
+    {
+      auto p = make_single_thread_shared<A>(1);
+      w = p;
+    }
+    REQUIRE(w.expired());
+    REQUIRE(A::dtor_count == 0);
+    reclamation::drain();
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Deleter and array") {
+    bool deleted = false;
+    {
+      single_thread_shared_ptr<A> p(new A, [&deleted](A *a) {
+        deleted = true;
+        delete a;
+      });
+      single_thread_shared_ptr<A[]> a(new A[3]);
+      auto m = make_single_thread_shared<A[]>(2);
+    }
+    REQUIRE(reclamation::size() == 3);
+    REQUIRE(!deleted);
+    reclamation::drain();
+    REQUIRE(deleted);
+    REQUIRE(A::dtor_count == 6);
+  }
+
+  SECTION("Assignment queues the previous object") {
+    single_thread_shared_ptr<A> p(new A);
+    p = make_single_thread_shared<A>(2);
+    REQUIRE(reclamation::size() == 1);
+    REQUIRE(p->value == 2);
+  }
+
+  SECTION("Objects which are still shared stay") {
+    auto p = make_single_thread_shared<A>();
+    { auto c = p; }
+    REQUIRE(reclamation::size() == 0);
+  }
+}
+
+TEST_CASE("drain respects its budget") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Object budget") {
+    for (int i = 0; i < 10; ++i)
+      make_single_thread_shared<A>(i);
+    REQUIRE(reclamation::drain(3) == 3);
+    REQUIRE(reclamation::size() == 7);
+    REQUIRE(reclamation::drain(0) == 0);
+    REQUIRE(reclamation::drain() == 7);
+    REQUIRE(A::dtor_count == 10);
+  }
+
+  SECTION("Destructors queue the children instead of recursing") {
+    { auto head = chain(100000); }
+    REQUIRE(reclamation::size() == 1);
+    REQUIRE(reclamation::drain(10) == 10);
+    REQUIRE(Node::dtor_count == 10);
+    REQUIRE(reclamation::size() == 1);
+    REQUIRE(reclamation::drain() == 99990);
+    REQUIRE(Node::dtor_count == 100000);
+  }
+
+  SECTION("Time budget deletes at least one object") {
+    for (int i = 0; i < 10; ++i)
+      make_single_thread_shared<A>(i);
+    REQUIRE(reclamation::drainFor(std::chrono::nanoseconds{0}) == 1);
+    REQUIRE(reclamation::drainFor(std::chrono::seconds{10}) == 9);
+  }
+
+  SECTION("Queues are per thread and drained at thread exit") {
+    long deleted_before_join = -1;
+    std::thread([&] {
+      make_single_thread_shared<A>();
+      deleted_before_join = A::dtor_count;
+    }).join();
+    REQUIRE(deleted_before_join == 0);
+    REQUIRE(A::dtor_count == 1);
+    REQUIRE(reclamation::size() == 0);
+  }
+}
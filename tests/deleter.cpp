@@ -0,0 +1,107 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <cstdio>
+
+namespace {
+struct Base {
+  ~Base() { ++base_dtor_count; } // not virtual
+  static long base_dtor_count;
+};
+long Base::base_dtor_count = 0;
+
+struct Derived : Base {
+  ~Derived() { ++derived_dtor_count; }
+  static long derived_dtor_count;
+};
+long Derived::derived_dtor_count = 0;
+
+struct counting_deleter {
+  template <typename T> void operator()(T *p) const {
+    ++*count;
+    delete p;
+  }
+  long *count;
+};
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    Base::base_dtor_count = 0;
+    Derived::derived_dtor_count = 0;
+  }
+};
+} // namespace
+
+TEST_CASE("single_thread_shared_ptr with a custom deleter") {
+  reset_count_struct __attribute__((unused)) reset;
+  long deleted = 0;
+
+  SECTION("Deleter is called by the last owner") {
+    {
+      single_thread_shared_ptr<int> p(new int(1), counting_deleter{&deleted});
+      auto copy = p;
+      REQUIRE(p.use_count() == 2);
+      p.reset();
+      REQUIRE(deleted == 0);
+    }
+    REQUIRE(deleted == 1);
+  }
+
+  SECTION("Lambda deleter") {
+    {
+      single_thread_shared_ptr<int> p(new int(1), [&](int *p) {
+        ++deleted;
+        delete p;
+      });
+    }
+    REQUIRE(deleted == 1);
+  }
+
+  SECTION("Deleter is called for nullptr") {
+    { single_thread_shared_ptr<int> p(nullptr, counting_deleter{&deleted}); }
+    REQUIRE(deleted == 1);
+  }
+
+  SECTION("Derived is destroyed through a base without virtual destructor") {
+    {
+      single_thread_shared_ptr<Base> p(new Derived,
+                                       std::default_delete<Derived>());
+      auto copy = p;
+    }
+    REQUIRE(Derived::derived_dtor_count == 1);
+    REQUIRE(Base::base_dtor_count == 1);
+  }
+
+  SECTION("File handle") {
+    std::FILE *f = std::tmpfile();
+    REQUIRE(f != nullptr);
+    single_thread_shared_ptr<std::FILE> p(f, [&](std::FILE *f) {
+      ++deleted;
+      std::fclose(f);
+    });
+    p.reset();
+    REQUIRE(deleted == 1);
+  }
+
+  SECTION("reset with a deleter") {
+    single_thread_shared_ptr<int> p(new int(1));
+    p.reset(new int(2), counting_deleter{&deleted});
+    REQUIRE(*p == 2);
+    p.reset();
+    REQUIRE(deleted == 1);
+  }
+
+  SECTION("Weak pointer outlives the object") {
+    single_thread_weak_ptr<int> w;
+    {
+      single_thread_shared_ptr<int> p(new int(1), counting_deleter{&deleted});
+      w = p;
+    }
+    REQUIRE(deleted == 1);
+    REQUIRE(w.expired());
+  }
+}
+
+static_assert(sizeof(single_thread_shared_ptr<int>) == 2 * sizeof(void *),
+              "a deleter does not change the pointer size");
@@ -0,0 +1,198 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+struct A {
+  A() { ++ctor_count; }
+  explicit A(int v) : value{v} { ++ctor_count; }
+  virtual ~A() { ++dtor_count; }
+  int value{0};
+  static long ctor_count;
+  static long dtor_count;
+};
+long A::ctor_count = 0;
+long A::dtor_count = 0;
+
+struct B : A {
+  B() : A(2) {}
+};
+
+struct counting_deleter {
+  int *calls;
+  void operator()(A *a) const {
+    ++*calls;
+    delete a;
+  }
+};
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    A::ctor_count = 0;
+    A::dtor_count = 0;
+  }
+};
+} // namespace
+
+TEST_CASE("into_std_shared moves a sole owner into std::shared_ptr") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Object owned through a raw pointer") {
+    single_thread_shared_ptr<A> p(new A(1));
+    auto *object = p.get();
+    {
+      std::shared_ptr<A> s = p.into_std_shared();
+      REQUIRE(!p);
+      REQUIRE(s.get() == object);
+      REQUIRE(s.use_count() == 1);
+      REQUIRE(A::dtor_count == 0);
+    }
+    REQUIRE(A::ctor_count == 1);
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Survivor of a copy") {
+    single_thread_shared_ptr<A> p(new A(1));
+    { auto c = p; }
+    auto s = p.into_std_shared();
+    REQUIRE(s->value == 1);
+  }
+
+  SECTION("Co-allocated object stays in place") {
+    auto p = make_single_thread_shared<A>(3);
+    auto *object = p.get();
+    {
+      auto s = p.into_std_shared();
+      REQUIRE(s.get() == object);
+      std::thread([s] { REQUIRE(s->value == 3); }).join();
+    }
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Custom deleter and arrays") {
+    int calls = 0;
+    {
+      single_thread_shared_ptr<A> p(new A, counting_deleter{&calls});
+      auto s = p.into_std_shared();
+      auto a = make_single_thread_shared<A[]>(4).into_std_shared();
+      std::shared_ptr<A[]> r = single_thread_shared_ptr<A[]>(new A[2]).into_std_shared();
+    }
+    REQUIRE(calls == 1);
+    REQUIRE(A::dtor_count == 7);
+  }
+
+  SECTION("Empty pointer") {
+    single_thread_shared_ptr<A> p;
+    REQUIRE(p.into_std_shared() == nullptr);
+  }
+
+  SECTION("Shared or observed objects are refused") {
+    auto p = make_single_thread_shared<A>();
+    auto c = p;
+    REQUIRE_THROWS_AS(p.into_std_shared(), std::logic_error);
+    REQUIRE(p.use_count() == 2);
+    c.reset();
+    single_thread_weak_ptr<A> w(p);
+    REQUIRE_THROWS_AS(p.release_to_thread(), std::logic_error);
+    w.reset();
+    REQUIRE(p.into_std_shared());
+  }
+}
+
+TEST_CASE("release_to_thread hands the object to another thread") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("The receiving thread owns a new single_thread_shared_ptr") {
+    auto p = make_single_thread_shared<A>(5);
+    auto *object = p.get();
+    auto handoff = p.release_to_thread();
+    REQUIRE(!p);
+    REQUIRE(handoff.get() == object);
+    std::thread([h = std::move(handoff), object]() mutable {
+      auto q = h.into_shared();
+      REQUIRE(!h);
+      REQUIRE(q.get() == object);
+      auto c = q;
+      REQUIRE(q.use_count() == 2);
+    }).join();
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Raw pointer owner") {
+    single_thread_shared_ptr<A> p(new A);
+    auto handoff = p.release_to_thread();
+    std::thread([h = std::move(handoff)]() mutable {
+      auto q = h.into_shared();
+      REQUIRE(q.use_count() == 1);
+    }).join();
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Unused handle deletes the object") {
+    {
+      auto handoff = make_single_thread_shared<A>().release_to_thread();
+      single_thread_handoff<A> other;
+      other = std::move(handoff);
+      REQUIRE(!handoff);
+      REQUIRE(other);
+    }
+    REQUIRE(A::dtor_count == 1);
+  }
+}
+
+TEST_CASE("single_thread_shared_ptr adopts std::unique_ptr") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Default deleter") {
+    auto u = std::make_unique<B>();
+    auto *object = u.get();
+    single_thread_shared_ptr<A> p(std::move(u));
+    REQUIRE(!u);
+    REQUIRE(p.get() == object);
+    REQUIRE(p.use_count() == 1);
+    REQUIRE(p->value == 2);
+  }
+
+  SECTION("Custom deleter") {
+    int calls = 0;
+    {
+      std::unique_ptr<A, counting_deleter> u(new A, counting_deleter{&calls});
+      single_thread_shared_ptr<A> p = std::move(u);
+      auto c = p;
+    }
+    REQUIRE(calls == 1);
+  }
+
+  SECTION("Deleter held by reference") {
+    int calls = 0;
+    counting_deleter d{&calls};
+    { single_thread_shared_ptr<A> p(std::unique_ptr<A, counting_deleter &>(new A, d)); }
+    REQUIRE(calls == 1);
+  }
+
+  SECTION("Array") {
+    { single_thread_shared_ptr<A[]> p(std::make_unique<A[]>(3)); }
+    REQUIRE(A::dtor_count == 3);
+  }
+
+  SECTION("Empty unique_ptr") {
+    single_thread_shared_ptr<A> p(std::unique_ptr<A>{});
+    REQUIRE(!p);
+  }
+
+  SECTION("Round trip") {
+    single_thread_shared_ptr<A> p(std::make_unique<A>(9));
+    auto s = p.into_std_shared();
+    REQUIRE(s->value == 9);
+    REQUIRE(A::ctor_count == 1);
+  }
+}
+
+static_assert(!std::is_constructible_v<single_thread_shared_ptr<A>,
+                                       std::unique_ptr<A[]>>);
+static_assert(!std::is_constructible_v<single_thread_shared_ptr<B>,
+                                       std::unique_ptr<A>>);
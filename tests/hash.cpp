@@ -2,6 +2,9 @@
 
 #include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
 
+#include <unordered_set>
+#include <vector>
+
 namespace {
 struct T {};
 } // namespace
@@ -13,3 +16,88 @@ TEST_CASE("single_thread_shared_ptr generates good hash") {
 
   REQUIRE(hs0(s0) == hp0(s0.get()));
 }
+
+namespace {
+struct Base {
+  virtual ~Base() = default;
+};
+struct Other {
+  virtual ~Other() = default;
+  int other{0};
+};
+struct Derived : Other, Base {};
+} // namespace
+
+TEST_CASE("Transparent lookup by raw pointer") {
+  using set_type =
+      std::unordered_set<single_thread_shared_ptr<Base>,
+                         single_thread_shared_ptr_hash<Base>,
+                         single_thread_shared_ptr_equal<Base>>;
+
+  SECTION("Unordered set finds elements without touching the counts") {
+    set_type set;
+    std::vector<Base *> raw;
+    for (int i = 0; i < 10; ++i) {
+      auto p = make_single_thread_shared<Base>();
+      raw.push_back(p.get());
+      set.insert(std::move(p));
+    }
+
+    for (auto *p : raw) {
+      auto it = set.find(single_thread_lookup_key(p));
+      REQUIRE(it != set.end());
+      REQUIRE(it->get() == p);
+      REQUIRE(it->use_count() == 1);
+    }
+
+    Base unrelated;
+    auto key = single_thread_lookup_key(&unrelated);
+    REQUIRE(key.use_count() == 0);
+    REQUIRE(set.find(key) == set.end());
+
+#if defined(__cpp_lib_generic_unordered_lookup)
+    REQUIRE(set.find(raw[3])->get() == raw[3]);
+    REQUIRE(set.find(static_cast<const Base *>(raw[3]))->get() == raw[3]);
+    REQUIRE(set.count(&unrelated) == 0);
+#endif
+  }
+
+  SECTION("Copies of a lookup key own nothing") {
+    auto p = make_single_thread_shared<Base>();
+    {
+      auto key = single_thread_lookup_key(p.get());
+      auto copy = key;
+      single_thread_shared_ptr<Base> assigned;
+      assigned = copy;
+      REQUIRE(copy.get() == p.get());
+      REQUIRE(key.use_count() == 0);
+      REQUIRE(copy.use_count() == 0);
+      REQUIRE(assigned.use_count() == 0);
+      key.reset();
+      copy.reset();
+    }
+    REQUIRE(p.use_count() == 1);
+  }
+
+  SECTION("Derived pointers hash like the base they convert to") {
+    set_type set;
+    single_thread_shared_ptr<Derived> d(new Derived);
+    set.insert(d);
+    REQUIRE(set.count(single_thread_lookup_key<Base>(d.get())) == 1);
+    REQUIRE(d.use_count() == 2);
+    REQUIRE(single_thread_shared_ptr_hash<Base>()(d.get()) ==
+            single_thread_shared_ptr_hash<Base>()(d));
+    REQUIRE(single_thread_shared_ptr_hash<Base>()(d) ==
+            std::hash<single_thread_shared_ptr<Base>>()(
+                single_thread_shared_ptr<Base>(d)));
+  }
+
+  SECTION("Equality mixes pointers and raw pointers") {
+    single_thread_shared_ptr_equal<Base> equal;
+    auto p = make_single_thread_shared<Base>();
+    REQUIRE(equal(p, p.get()));
+    REQUIRE(equal(p.get(), p));
+    REQUIRE(!equal(p, nullptr));
+    REQUIRE(equal(single_thread_shared_ptr<Base>(), nullptr));
+  }
+}
@@ -0,0 +1,153 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_intrusive_ptr.hpp>
+
+#include <unordered_set>
+
+namespace {
+struct A : single_thread_intrusive_ref_counter<A> {
+  A() { ++ctor_count; }
+  A(const A &rhs) : single_thread_intrusive_ref_counter<A>(rhs) { ++ctor_count; }
+  ~A() { ++dtor_count; }
+  static long ctor_count;
+  static long dtor_count;
+};
+long A::ctor_count = 0;
+long A::dtor_count = 0;
+
+struct B : A {
+  int value{5};
+};
+
+// keeps its count without the helper base
+struct handle {
+  unsigned refs{0};
+  static long released;
+};
+long handle::released = 0;
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    A::ctor_count = 0;
+    A::dtor_count = 0;
+  }
+};
+} // namespace
+
+template <> struct single_thread_intrusive_ptr_traits<handle> {
+  static void add_ref(handle *p) noexcept { ++p->refs; }
+  static void release(handle *p) noexcept {
+    if (--p->refs == 0)
+      ++handle::released;
+  }
+  static long use_count(const handle *p) noexcept { return p->refs; }
+};
+
+static_assert(sizeof(single_thread_intrusive_ptr<A>) == sizeof(A *),
+              "intrusive pointer is one word");
+
+TEST_CASE("single_thread_intrusive_ptr ownership") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Empty pointer") {
+    single_thread_intrusive_ptr<A> p;
+    REQUIRE(p.get() == nullptr);
+    REQUIRE(p.use_count() == 0);
+    REQUIRE(!p);
+  }
+
+  SECTION("Copies share the embedded count") {
+    {
+      auto p1 = make_single_thread_intrusive<A>();
+      REQUIRE(p1.use_count() == 1);
+      auto p2 = p1;
+      REQUIRE(p1.use_count() == 2);
+      REQUIRE(p2->use_count() == 2);
+      p1.reset();
+      REQUIRE(A::dtor_count == 0);
+      REQUIRE(p2.use_count() == 1);
+    }
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Raw pointer can be adopted again") {
+    auto p1 = make_single_thread_intrusive<A>();
+    single_thread_intrusive_ptr<A> p2(p1.get());
+    REQUIRE(p1.use_count() == 2);
+  }
+
+  SECTION("Move does not touch the count") {
+    auto p1 = make_single_thread_intrusive<A>();
+    auto p2 = std::move(p1);
+    REQUIRE(p1.get() == nullptr);
+    REQUIRE(p2.use_count() == 1);
+  }
+
+  SECTION("Derived to base conversion") {
+    auto b = make_single_thread_intrusive<B>();
+    single_thread_intrusive_ptr<A> a(b);
+    REQUIRE(a.use_count() == 2);
+    single_thread_intrusive_ptr<A> a2(std::move(b));
+    REQUIRE(a.use_count() == 2);
+  }
+
+  SECTION("detach and adopt") {
+    auto p = make_single_thread_intrusive<A>();
+    A *raw = p.detach();
+    REQUIRE(raw->use_count() == 1);
+    single_thread_intrusive_ptr<A> p2(raw, false);
+    REQUIRE(p2.use_count() == 1);
+  }
+
+  SECTION("Copy of the object has its own count") {
+    auto p1 = make_single_thread_intrusive<A>();
+    auto p2 = make_single_thread_intrusive<A>(*p1);
+    REQUIRE(p1.use_count() == 1);
+    REQUIRE(p2.use_count() == 1);
+  }
+
+  REQUIRE(A::ctor_count == A::dtor_count);
+}
+
+TEST_CASE("single_thread_intrusive_ptr custom traits") {
+  handle h;
+  {
+    single_thread_intrusive_ptr<handle> p1(&h);
+    auto p2 = p1;
+    REQUIRE(p2.use_count() == 2);
+  }
+  REQUIRE(h.refs == 0);
+  REQUIRE(handle::released == 1);
+}
+
+TEST_CASE("single_thread_intrusive_ptr comparison operators") {
+  auto p1 = make_single_thread_intrusive<A>();
+  auto p2 = make_single_thread_intrusive<A>();
+  single_thread_intrusive_ptr<A> empty;
+
+  REQUIRE(p1 == p1);
+  REQUIRE(p1 != p2);
+  REQUIRE(empty == nullptr);
+  REQUIRE(nullptr == empty);
+  REQUIRE(p1 != nullptr);
+  REQUIRE(nullptr != p1);
+  REQUIRE((p1 < p2) == (p1.get() < p2.get()));
+  REQUIRE((p1 <= p2) == (p1.get() <= p2.get()));
+  REQUIRE((p1 > p2) == (p1.get() > p2.get()));
+  REQUIRE((p1 >= p2) == (p1.get() >= p2.get()));
+  REQUIRE(!(empty < nullptr));
+  REQUIRE(empty <= nullptr);
+  REQUIRE(empty >= nullptr);
+  REQUIRE(!(nullptr > empty));
+}
+
+TEST_CASE("single_thread_intrusive_ptr generates good hash") {
+  auto p = make_single_thread_intrusive<A>();
+  REQUIRE(std::hash<single_thread_intrusive_ptr<A>>()(p) ==
+          std::hash<A *>()(p.get()));
+
+  std::unordered_set<single_thread_intrusive_ptr<A>> set;
+  set.insert(p);
+  set.insert(p);
+  REQUIRE(set.size() == 1);
+}
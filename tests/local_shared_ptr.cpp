@@ -0,0 +1,163 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_local_shared_ptr.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+struct A {
+  A() = default;
+  explicit A(int v) : value{v} {}
+  virtual ~A() { ++dtor_count; }
+  int value{0};
+  static std::atomic<long> dtor_count;
+};
+std::atomic<long> A::dtor_count{0};
+
+struct B : A {
+  B() : A(2) {}
+};
+
+struct reset_count_struct {
+  ~reset_count_struct() { A::dtor_count = 0; }
+};
+} // namespace
+
+TEST_CASE("single_thread_local_shared_ptr counts owners on one thread") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Copies change only the local count") {
+    {
+      auto p = make_single_thread_local_shared<A>(1);
+      REQUIRE(p.local_use_count() == 1);
+      REQUIRE(p.thread_count() == 1);
+      auto c = p;
+      single_thread_local_shared_ptr<A> d;
+      d = c;
+      REQUIRE(p.local_use_count() == 3);
+      REQUIRE(p.thread_count() == 1);
+      REQUIRE(d->value == 1);
+      auto m = std::move(c);
+      REQUIRE(!c);
+      REQUIRE(p.local_use_count() == 3);
+    }
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Raw pointer and conversions") {
+    {
+      single_thread_local_shared_ptr<A> p(new B);
+      single_thread_local_shared_ptr<const A> c = p;
+      REQUIRE(c->value == 2);
+      REQUIRE(c.local_use_count() == 2);
+      p.reset(new A(3));
+      REQUIRE(A::dtor_count == 0);
+      REQUIRE(p->value == 3);
+    }
+    REQUIRE(A::dtor_count == 2);
+  }
+
+  SECTION("Empty pointers") {
+    single_thread_local_shared_ptr<A> p;
+    single_thread_local_shared_ptr<A> n(static_cast<A *>(nullptr));
+    REQUIRE(p == nullptr);
+    REQUIRE(n == nullptr);
+    REQUIRE(p.local_use_count() == 0);
+    REQUIRE(!p.to_thread());
+    REQUIRE(!single_thread_local_shared_ptr<A>(p.to_thread()));
+  }
+}
+
+TEST_CASE("single_thread_cross_thread_ptr moves objects between threads") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Each thread holds one count of the thread count") {
+    auto p = make_single_thread_local_shared<A>(4);
+    auto cross = p.to_thread();
+    REQUIRE(p.thread_count() == 2);
+    REQUIRE(p.local_use_count() == 1);
+    std::thread([&p, cross = std::move(cross)]() mutable {
+      single_thread_local_shared_ptr<A> q(std::move(cross));
+      REQUIRE(!cross);
+      REQUIRE(q.get() == p.get());
+      REQUIRE(q.thread_count() == 2);
+      auto c = q;
+      REQUIRE(q.local_use_count() == 2);
+      REQUIRE(p.local_use_count() == 1);
+    }).join();
+    REQUIRE(p.thread_count() == 1);
+    REQUIRE(A::dtor_count == 0);
+  }
+
+  SECTION("Each handoff to a thread has a local count of its own") {
+    auto p = make_single_thread_local_shared<A>(4);
+    auto first = p.to_thread();
+    auto second = p.to_thread();
+    std::thread([&p, &first, &second] {
+      single_thread_local_shared_ptr<A> q(std::move(first));
+      single_thread_local_shared_ptr<A> r(std::move(second));
+      REQUIRE(q.get() == r.get());
+      REQUIRE(q.local_use_count() == 1);
+      REQUIRE(r.local_use_count() == 1);
+      REQUIRE(p.thread_count() == 3);
+      q.reset();
+      REQUIRE(p.thread_count() == 2);
+    }).join();
+    REQUIRE(p.thread_count() == 1);
+    REQUIRE(A::dtor_count == 0);
+  }
+
+  SECTION("The last thread deletes the object") {
+    long deleted = -1;
+    {
+      auto p = make_single_thread_local_shared<A>();
+      std::thread t([&deleted, cross = p.to_thread()] {
+        single_thread_local_shared_ptr<A> q(cross);
+        // wait for the creating thread to drop its owners
+        while (q.thread_count() != 2)
+          std::this_thread::yield();
+        q.reset();
+        deleted = A::dtor_count;
+      });
+      p.reset();
+      t.join();
+    }
+    REQUIRE(deleted == 0);
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Cross thread pointers convert and copy") {
+    {
+      single_thread_local_shared_ptr<B> p(new B);
+      single_thread_cross_thread_ptr<A> cross = p.to_thread();
+      auto copy = cross;
+      REQUIRE(p.thread_count() == 3);
+      copy.reset();
+      single_thread_local_shared_ptr<A> q(cross);
+      REQUIRE(p.thread_count() == 3);
+      REQUIRE(q->value == 2);
+    }
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Many threads") {
+    auto p = make_single_thread_local_shared<A>(5);
+    std::vector<std::thread> threads;
+    std::atomic<long> sum{0};
+    for (int i = 0; i < 8; ++i)
+      threads.emplace_back([&sum, cross = p.to_thread()]() mutable {
+        for (int j = 0; j < 1000; ++j) {
+          single_thread_local_shared_ptr<A> q(cross);
+          auto c = q;
+          sum += c->value;
+        }
+      });
+    p.reset();
+    for (auto &t : threads)
+      t.join();
+    REQUIRE(sum == 8 * 1000 * 5);
+    REQUIRE(A::dtor_count == 1);
+  }
+}
@@ -0,0 +1,96 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+namespace {
+struct A {
+  A() { ++ctor_count; }
+  A(int v) : value{v} { ++ctor_count; }
+  virtual ~A() { ++dtor_count; }
+  int value{0};
+  static long ctor_count;
+  static long dtor_count;
+};
+long A::ctor_count = 0;
+long A::dtor_count = 0;
+
+struct B : A {
+  B() { ++ctor_count; }
+  virtual ~B() { ++dtor_count; }
+  static long ctor_count;
+  static long dtor_count;
+};
+long B::ctor_count = 0;
+long B::dtor_count = 0;
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    A::ctor_count = 0;
+    A::dtor_count = 0;
+    B::ctor_count = 0;
+    B::dtor_count = 0;
+  }
+};
+} // namespace
+
+TEST_CASE("make_single_thread_shared creates a managed object") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Arguments are forwarded to the constructor") {
+    auto p = make_single_thread_shared<A>(42);
+    REQUIRE(p->value == 42);
+    REQUIRE(p.use_count() == 1);
+    REQUIRE(A::ctor_count == 1);
+  }
+
+  SECTION("Object is destroyed with the last owner") {
+    {
+      auto p1 = make_single_thread_shared<A>();
+      {
+        auto p2 = p1;
+        REQUIRE(p1.use_count() == 2);
+        REQUIRE(p2.use_count() == 2);
+      }
+      REQUIRE(p1.use_count() == 1);
+      REQUIRE(A::dtor_count == 0);
+    }
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Copy assignment shares the object") {
+    auto p1 = make_single_thread_shared<A>();
+    single_thread_shared_ptr<A> p2(new A);
+    p2 = p1;
+    REQUIRE(A::dtor_count == 1);
+    REQUIRE(p1.get() == p2.get());
+    REQUIRE(p2.use_count() == 2);
+  }
+
+  SECTION("Assigning over the last owner destroys the object") {
+    auto p = make_single_thread_shared<A>();
+    p = single_thread_shared_ptr<A>();
+    REQUIRE(p.get() == nullptr);
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Move to a base class pointer") {
+    auto b = make_single_thread_shared<B>();
+    single_thread_shared_ptr<A> a(std::move(b));
+    REQUIRE(b.get() == nullptr);
+    REQUIRE(a.use_count() == 1);
+    a.reset();
+    REQUIRE(A::dtor_count == 1);
+    REQUIRE(B::dtor_count == 1);
+  }
+
+  SECTION("Reset of one owner keeps the object alive") {
+    auto p1 = make_single_thread_shared<A>();
+    auto p2 = p1;
+    p1.reset();
+    REQUIRE(A::dtor_count == 0);
+    REQUIRE(p2.use_count() == 1);
+  }
+
+  REQUIRE(A::ctor_count == A::dtor_count);
+  REQUIRE(B::ctor_count == B::dtor_count);
+}
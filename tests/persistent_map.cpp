@@ -0,0 +1,241 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_persistent_map.hpp>
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+struct Value {
+  Value(int v) : value{v} { ++alive; }
+  Value(const Value &rhs) : value{rhs.value} {
+    ++alive;
+    ++copies;
+  }
+  Value(Value &&rhs) noexcept : value{rhs.value} { ++alive; }
+  Value &operator=(const Value &) = default;
+  Value &operator=(Value &&) = default;
+  ~Value() { --alive; }
+
+  int value;
+  static long alive;
+  static long copies;
+};
+long Value::alive = 0;
+long Value::copies = 0;
+
+// few distinct hashes, so keys share long prefixes and whole hashes
+struct CollidingHash {
+  std::size_t operator()(int key) const noexcept {
+    return std::size_t(key % 5) * 0x9e3779b97f4a7c15ull;
+  }
+};
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    Value::alive = 0;
+    Value::copies = 0;
+  }
+};
+
+template <typename Map>
+bool same(const Map &m, const std::map<int, int> &expected) {
+  if (m.size() != expected.size())
+    return false;
+  std::size_t visited = 0;
+  for (const auto &[key, value] : m) {
+    auto it = expected.find(key);
+    if (it == expected.end() || it->second != value)
+      return false;
+    ++visited;
+  }
+  for (const auto &[key, value] : expected)
+    if (!m.contains(key) || m.at(key) != value)
+      return false;
+  return visited == expected.size();
+}
+} // namespace
+
+TEST_CASE("single_thread_persistent_map keeps every version") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Insert, assign, find and erase") {
+    single_thread_persistent_map<std::string, int> m{{"one", 1}, {"two", 2}};
+    REQUIRE(m.size() == 2);
+    REQUIRE(m.at("one") == 1);
+    REQUIRE(!m.insert({"one", 10}));
+    REQUIRE(m.at("one") == 1);
+    REQUIRE(!m.insert_or_assign("one", 11));
+    REQUIRE(m.at("one") == 11);
+    REQUIRE(m.insert_or_assign(std::string("three"), 3));
+    REQUIRE(m.find("three")->second == 3);
+    REQUIRE(m.find("four") == m.end());
+    REQUIRE(m.count("two") == 1);
+    REQUIRE_THROWS_AS(m.at("four"), std::out_of_range);
+    REQUIRE(m.update("two", [](int &v) { v = 22; }));
+    REQUIRE(!m.update("four", [](int &v) { v = 4; }));
+    REQUIRE(m.at("two") == 22);
+    REQUIRE(m.erase("one") == 1);
+    REQUIRE(m.erase("one") == 0);
+    REQUIRE(m.size() == 2);
+    m.erase("two");
+    m.erase("three");
+    REQUIRE(m.empty());
+    REQUIRE(m.begin() == m.end());
+  }
+
+  SECTION("Many keys") {
+    single_thread_persistent_map<int, int> m;
+    std::map<int, int> expected;
+    for (int i = 0; i < 50000; ++i) {
+      m.insert_or_assign(i * 7919, i);
+      expected[i * 7919] = i;
+    }
+    REQUIRE(same(m, expected));
+    for (int i = 0; i < 50000; i += 3) {
+      m.erase(i * 7919);
+      expected.erase(i * 7919);
+    }
+    REQUIRE(same(m, expected));
+  }
+
+  SECTION("Changes to a copy leave the original alone") {
+    single_thread_persistent_map<int, int> m;
+    for (int i = 0; i < 1000; ++i)
+      m.insert_or_assign(i, i);
+    auto copy = m;
+    copy.insert_or_assign(5, -5);
+    copy.insert_or_assign(1000, 1000);
+    copy.erase(7);
+    copy.update(9, [](int &v) { v = -9; });
+    REQUIRE(m.size() == 1000);
+    REQUIRE(m.at(5) == 5);
+    REQUIRE(m.at(7) == 7);
+    REQUIRE(m.at(9) == 9);
+    REQUIRE(!m.contains(1000));
+    REQUIRE(copy.size() == 1000);
+    REQUIRE(copy.at(5) == -5);
+    REQUIRE(!copy.contains(7));
+    REQUIRE(copy.at(9) == -9);
+  }
+
+  SECTION("Keys with equal hashes") {
+    single_thread_persistent_map<int, int, CollidingHash> m;
+    std::map<int, int> expected;
+    for (int i = 0; i < 200; ++i) {
+      m.insert_or_assign(i, i);
+      expected[i] = i;
+    }
+    REQUIRE(same(m, expected));
+    auto before = m;
+    auto before_expected = expected;
+    for (int i = 0; i < 200; i += 2) {
+      m.erase(i);
+      expected.erase(i);
+      REQUIRE(same(m, expected));
+    }
+    REQUIRE(same(before, before_expected));
+    for (int i = 1; i < 200; i += 2)
+      m.erase(i);
+    REQUIRE(m.empty());
+  }
+
+  SECTION("Random changes to random versions") {
+    std::mt19937 rng(7);
+    std::vector<single_thread_persistent_map<int, int>> versions(1);
+    std::vector<std::map<int, int>> expected(1);
+    for (int step = 0; step < 2000; ++step) {
+      std::size_t from = rng() % versions.size();
+      auto m = versions[from];
+      auto e = expected[from];
+      for (int change = 0; change < 16; ++change) {
+        int key = int(rng() % 3000);
+        if (rng() % 3) {
+          int value = int(rng());
+          REQUIRE(m.insert_or_assign(key, value) == (e.count(key) == 0));
+          e[key] = value;
+        } else {
+          REQUIRE(m.erase(key) == e.erase(key));
+        }
+      }
+      versions.push_back(std::move(m));
+      expected.push_back(std::move(e));
+    }
+    for (std::size_t i = 0; i < versions.size(); i += 50)
+      REQUIRE(same(versions[i], expected[i]));
+  }
+
+  SECTION("Iterating from a found entry visits the rest") {
+    single_thread_persistent_map<int, int> m;
+    for (int i = 0; i < 3000; ++i)
+      m.insert_or_assign(i, i);
+    std::vector<int> order;
+    for (const auto &entry : m)
+      order.push_back(entry.first);
+    REQUIRE(order.size() == 3000);
+    std::size_t middle = 1234;
+    auto it = m.find(order[middle]);
+    for (std::size_t i = middle; i < order.size(); ++i, ++it)
+      REQUIRE(it->first == order[i]);
+    REQUIRE(it == m.end());
+  }
+
+  SECTION("A map nobody shares changes in place") {
+    single_thread_persistent_map<int, Value> m;
+    for (int i = 0; i < 2000; ++i)
+      m.insert_or_assign(i, Value(i));
+    for (int i = 0; i < 2000; i += 3)
+      m.erase(i);
+    for (int i = 0; i < 2000; i += 5)
+      m.update(i + 1, [](Value &v) { v.value = -1; });
+    REQUIRE(Value::copies == 0);
+  }
+
+  SECTION("A batch of changes to a copy copies each path once") {
+    single_thread_persistent_map<int, Value> m;
+    for (int i = 0; i < 40; ++i)
+      m.insert_or_assign(i, Value(i));
+    auto copy = m;
+    long before = Value::copies;
+    copy.update(0, [](Value &v) { v.value = -1; });
+    long first = Value::copies - before;
+    REQUIRE(first > 0);
+    for (int i = 0; i < 40; ++i)
+      copy.update(0, [](Value &v) { v.value = -2; });
+    REQUIRE(Value::copies - before == first);
+    REQUIRE(m.at(0).value == 0);
+    REQUIRE(copy.at(0).value == -2);
+  }
+
+  SECTION("A moved from map is empty and can be used again") {
+    single_thread_persistent_map<int, int> m;
+    for (int i = 0; i < 10; ++i)
+      m.insert_or_assign(i, i);
+    auto moved = std::move(m);
+    REQUIRE(moved.size() == 10);
+    REQUIRE(m.empty());
+    REQUIRE(!m.contains(1));
+    m.insert_or_assign(1, -1);
+    REQUIRE(m.size() == 1);
+    REQUIRE(m.at(1) == -1);
+    moved = std::move(m);
+    REQUIRE(same(moved, {{1, -1}}));
+    REQUIRE(m.empty());
+    REQUIRE(m.begin() == m.end());
+  }
+
+  SECTION("Every entry is destroyed with the last version") {
+    {
+      single_thread_persistent_map<int, Value, CollidingHash> m;
+      for (int i = 0; i < 500; ++i)
+        m.insert_or_assign(i, Value(i));
+      auto copy = m;
+      for (int i = 0; i < 500; i += 2)
+        copy.erase(i);
+      copy.insert_or_assign(1, Value(-1));
+    }
+    REQUIRE(Value::alive == 0);
+  }
+}
@@ -0,0 +1,223 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_persistent_vector.hpp>
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+struct Item {
+  Item(int v) : value{v} { ++alive; }
+  Item(const Item &rhs) : value{rhs.value} {
+    ++alive;
+    ++copies;
+  }
+  Item &operator=(const Item &) = default;
+  ~Item() { --alive; }
+  bool operator==(const Item &rhs) const { return value == rhs.value; }
+
+  int value;
+  static long alive;
+  static long copies;
+};
+long Item::alive = 0;
+long Item::copies = 0;
+
+// copying the element 20 fails
+struct Fragile : Item {
+  using Item::Item;
+  Fragile(const Fragile &rhs) : Item(rhs) {
+    if (value == 20)
+      throw std::runtime_error("copy");
+  }
+  Fragile &operator=(const Fragile &) = default;
+};
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    Item::alive = 0;
+    Item::copies = 0;
+  }
+};
+
+template <typename T>
+bool same(const single_thread_persistent_vector<T> &v,
+          const std::vector<T> &expected) {
+  return v.size() == expected.size() &&
+         std::equal(v.begin(), v.end(), expected.begin());
+}
+} // namespace
+
+TEST_CASE("single_thread_persistent_vector keeps every version") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Elements across several tree levels") {
+    constexpr int count = 40000; // deeper than two levels of 32
+    single_thread_persistent_vector<int> v;
+    std::vector<int> expected;
+    for (int i = 0; i < count; ++i) {
+      v.push_back(i);
+      expected.push_back(i);
+    }
+    REQUIRE(same(v, expected));
+    REQUIRE(v.front() == 0);
+    REQUIRE(v.back() == count - 1);
+    REQUIRE(v[1057] == 1057);
+    REQUIRE_THROWS_AS(v.at(count), std::out_of_range);
+
+    while (!v.empty()) {
+      v.pop_back();
+      expected.pop_back();
+      if (v.size() % 997 == 0 || v.size() < 70)
+        REQUIRE(same(v, expected));
+    }
+  }
+
+  SECTION("Changes to a copy leave the original alone") {
+    single_thread_persistent_vector<int> v;
+    for (int i = 0; i < 5000; ++i)
+      v.push_back(i);
+    auto copy = v;
+    copy.set(10, -1);
+    copy.set(4999, -2);
+    copy.push_back(5000);
+    copy.update(2500, [](int &x) { x *= 2; });
+    REQUIRE(v.size() == 5000);
+    REQUIRE(v[10] == 10);
+    REQUIRE(v[4999] == 4999);
+    REQUIRE(v[2500] == 2500);
+    REQUIRE(copy[10] == -1);
+    REQUIRE(copy[4999] == -2);
+    REQUIRE(copy[5000] == 5000);
+    REQUIRE(copy[2500] == 5000);
+
+    auto popped = v;
+    for (int i = 0; i < 100; ++i)
+      popped.pop_back();
+    REQUIRE(v.size() == 5000);
+    REQUIRE(v.back() == 4999);
+    REQUIRE(popped.back() == 4899);
+  }
+
+  SECTION("Random changes to random versions") {
+    std::mt19937 rng(42);
+    std::vector<single_thread_persistent_vector<int>> versions(1);
+    std::vector<std::vector<int>> expected(1);
+    for (int step = 0; step < 4000; ++step) {
+      std::size_t from = rng() % versions.size();
+      auto v = versions[from];
+      auto e = expected[from];
+      for (int change = 0; change < 8; ++change) {
+        unsigned what = rng() % 4;
+        if (what < 2 || e.empty()) {
+          int n = int(rng() % 64);
+          for (int i = 0; i < n; ++i) {
+            v.push_back(int(rng()));
+            e.push_back(v.back());
+          }
+        } else if (what == 2) {
+          std::size_t i = rng() % e.size();
+          v.set(i, int(rng()));
+          e[i] = v[i];
+        } else {
+          v.pop_back();
+          e.pop_back();
+        }
+      }
+      versions.push_back(std::move(v));
+      expected.push_back(std::move(e));
+    }
+    for (std::size_t i = 0; i < versions.size(); ++i)
+      REQUIRE(same(versions[i], expected[i]));
+  }
+
+  SECTION("A vector nobody shares changes in place") {
+    single_thread_persistent_vector<Item> v;
+    for (int i = 0; i < 3000; ++i)
+      v.emplace_back(i);
+    for (int i = 0; i < 3000; i += 7)
+      v.set(i, Item(-i));
+    while (v.size() > 1000)
+      v.pop_back();
+    REQUIRE(Item::copies == 0);
+    REQUIRE(v[7].value == -7);
+  }
+
+  SECTION("A batch of changes to a copy copies each path once") {
+    single_thread_persistent_vector<Item> v;
+    for (int i = 0; i < 64 * 32; ++i)
+      v.emplace_back(i);
+    auto copy = v;
+    long before = Item::copies;
+    for (int i = 0; i < 32; ++i)
+      copy.update(i, [](Item &item) { item.value = -1; });
+    // the first leaf is copied once, then written in place
+    REQUIRE(Item::copies - before == 32);
+    REQUIRE(v[0].value == 0);
+    REQUIRE(copy[0].value == -1);
+  }
+
+  SECTION("Every element is destroyed with the last version") {
+    {
+      single_thread_persistent_vector<Item> v;
+      for (int i = 0; i < 2000; ++i)
+        v.emplace_back(i);
+      auto copy = v;
+      copy.set(5, Item(5));
+      for (int i = 0; i < 300; ++i)
+        copy.pop_back();
+    }
+    REQUIRE(Item::alive == 0);
+  }
+
+  SECTION("A failed copy of a shared leaf leaves both versions alone") {
+    single_thread_persistent_vector<Fragile> v;
+    for (int i = 0; i < 32; ++i)
+      v.emplace_back(i);
+    auto copy = v;
+    REQUIRE_THROWS_AS(copy.set(0, Fragile(-1)), std::runtime_error);
+    REQUIRE(Item::alive == 32);
+    REQUIRE(copy.size() == 32);
+    REQUIRE(copy[0].value == 0);
+    REQUIRE(v[31].value == 31);
+  }
+
+  SECTION("A moved from vector is empty and can be used again") {
+    single_thread_persistent_vector<int> v;
+    for (int i = 0; i < 100; ++i)
+      v.push_back(i);
+    auto w = std::move(v);
+    REQUIRE(w.size() == 100);
+    REQUIRE(v.empty());
+    v.push_back(1);
+    REQUIRE(v.size() == 1);
+    REQUIRE(v[0] == 1);
+    w = std::move(v);
+    REQUIRE(w.size() == 1);
+    REQUIRE(v.empty());
+    for (int i = 0; i < 40; ++i)
+      v.push_back(i);
+    REQUIRE(v[39] == 39);
+  }
+
+  SECTION("Iterators") {
+    single_thread_persistent_vector<std::string> v{"a", "b", "c"};
+    REQUIRE(v.end() - v.begin() == 3);
+    auto it = v.begin();
+    REQUIRE(*it == "a");
+    REQUIRE(it[2] == "c");
+    it += 2;
+    REQUIRE(it->size() == 1);
+    REQUIRE(*--it == "b");
+    REQUIRE(std::find(v.begin(), v.end(), "c") == v.end() - 1);
+
+    std::vector<int> source(100);
+    for (int i = 0; i < 100; ++i)
+      source[i] = i;
+    single_thread_persistent_vector<int> w(source.begin(), source.end());
+    REQUIRE(same(w, source));
+  }
+}
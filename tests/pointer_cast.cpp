@@ -0,0 +1,272 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_cow.hpp>
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+struct A {
+  A() { ++ctor_count; }
+  virtual ~A() { ++dtor_count; }
+  int value{1};
+  static long ctor_count;
+  static long dtor_count;
+};
+long A::ctor_count = 0;
+long A::dtor_count = 0;
+
+struct B : A {
+  int other{2};
+};
+
+struct C {
+  virtual ~C() = default;
+};
+
+struct Pair {
+  Pair() { ++ctor_count; }
+  ~Pair() { ++dtor_count; }
+  int first{1};
+  int second{2};
+  static long ctor_count;
+  static long dtor_count;
+};
+long Pair::ctor_count = 0;
+long Pair::dtor_count = 0;
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    A::ctor_count = 0;
+    A::dtor_count = 0;
+    Pair::ctor_count = 0;
+    Pair::dtor_count = 0;
+  }
+};
+} // namespace
+
+TEST_CASE("Pointer casts") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("static_pointer_cast") {
+    {
+      single_thread_shared_ptr<A> a(new B);
+      auto b = static_pointer_cast<B>(a);
+      REQUIRE(b->other == 2);
+      REQUIRE(a.use_count() == 2);
+      a.reset();
+      REQUIRE(A::dtor_count == 0);
+      REQUIRE(b.use_count() == 1);
+    }
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("static_pointer_cast of an rvalue takes the count over") {
+    {
+      single_thread_shared_ptr<A> a(new B);
+      auto b = static_pointer_cast<B>(std::move(a));
+      REQUIRE(!a);
+      REQUIRE(b.use_count() == 1);
+      auto back = static_pointer_cast<A>(std::move(b));
+      REQUIRE(back.use_count() == 1);
+    }
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("const_pointer_cast") {
+    auto c = make_single_thread_shared<const A>();
+    auto m = const_pointer_cast<A>(c);
+    m->value = 5;
+    REQUIRE(c->value == 5);
+    REQUIRE(c.use_count() == 2);
+    auto moved = const_pointer_cast<A>(std::move(c));
+    REQUIRE(!c);
+    REQUIRE(moved.use_count() == 2);
+  }
+
+  SECTION("dynamic_pointer_cast") {
+    {
+      single_thread_shared_ptr<A> a(new B);
+      REQUIRE(dynamic_pointer_cast<B>(a)->other == 2);
+      REQUIRE(!dynamic_pointer_cast<C>(a));
+      REQUIRE(a.use_count() == 1);
+
+      auto failed = dynamic_pointer_cast<C>(std::move(a));
+      REQUIRE(!failed);
+      REQUIRE(failed.use_count() == 0);
+      REQUIRE(a);
+      REQUIRE(a.use_count() == 1);
+
+      auto b = dynamic_pointer_cast<B>(std::move(a));
+      REQUIRE(!a);
+      REQUIRE(b.use_count() == 1);
+    }
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("reinterpret_pointer_cast") {
+    {
+      single_thread_shared_ptr<Pair> p(new Pair);
+      auto bytes = reinterpret_pointer_cast<unsigned char>(p);
+      REQUIRE(static_cast<void *>(bytes.get()) == p.get());
+      p.reset();
+      REQUIRE(Pair::dtor_count == 0);
+      auto back = reinterpret_pointer_cast<Pair>(std::move(bytes));
+      REQUIRE(!bytes);
+      REQUIRE(back->second == 2);
+    }
+    REQUIRE(Pair::dtor_count == 1);
+  }
+
+  SECTION("Empty pointers stay empty") {
+    single_thread_shared_ptr<A> a;
+    REQUIRE(!static_pointer_cast<B>(a));
+    REQUIRE(!dynamic_pointer_cast<B>(a));
+    REQUIRE(!const_pointer_cast<const A>(std::move(a)));
+    REQUIRE(static_pointer_cast<B>(a).use_count() == 0);
+  }
+}
+
+TEST_CASE("Aliasing constructor") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Alias outliving a raw pointer owner deletes the object") {
+    single_thread_shared_ptr<int> second;
+    {
+      single_thread_shared_ptr<Pair> p(new Pair);
+      second = single_thread_shared_ptr<int>(p, &p->second);
+      REQUIRE(p.use_count() == 2);
+    }
+    REQUIRE(Pair::dtor_count == 0);
+    REQUIRE(*second == 2);
+    REQUIRE(second.use_count() == 1);
+    second.reset();
+    REQUIRE(Pair::dtor_count == 1);
+  }
+
+  SECTION("Rvalue alias takes the count over") {
+    single_thread_shared_ptr<int> first;
+    {
+      auto p = make_single_thread_shared<Pair>();
+      auto *pair = p.get();
+      first = single_thread_shared_ptr<int>(std::move(p), &pair->first);
+      REQUIRE(!p);
+    }
+    REQUIRE(first.use_count() == 1);
+    REQUIRE(*first == 1);
+    first.reset();
+    REQUIRE(Pair::dtor_count == 1);
+  }
+
+  SECTION("Rvalue alias of a sole raw pointer owner") {
+    single_thread_shared_ptr<Pair> p(new Pair);
+    auto *pair = p.get();
+    single_thread_shared_ptr<int> second(std::move(p), &pair->second);
+    REQUIRE(!p);
+    REQUIRE(second.use_count() == 1);
+    single_thread_weak_ptr<int> w(second);
+    second.reset();
+    REQUIRE(w.expired());
+    REQUIRE(Pair::dtor_count == 1);
+  }
+
+  SECTION("Survivor of a copy goes back inline before it is aliased") {
+    single_thread_shared_ptr<Pair> p(new Pair);
+    { auto c = p; }
+    single_thread_shared_ptr<int> first(p, &p->first);
+    p.reset();
+    REQUIRE(Pair::dtor_count == 0);
+    first.reset();
+    REQUIRE(Pair::dtor_count == 1);
+  }
+
+  SECTION("Alias of a shared raw pointer owner outliving every owner") {
+    single_thread_shared_ptr<int> second;
+    {
+      single_thread_shared_ptr<Pair> p(new Pair);
+      auto c = p;
+      second = single_thread_shared_ptr<int>(p, &p->second);
+      REQUIRE(p.use_count() == 3);
+      REQUIRE(second.use_count() == 1);
+    }
+    REQUIRE(Pair::dtor_count == 0);
+    REQUIRE(*second == 2);
+    auto copy = second;
+    second.reset();
+    REQUIRE(Pair::dtor_count == 0);
+    copy.reset();
+    REQUIRE(Pair::dtor_count == 1);
+  }
+
+  SECTION("Owners outliving an alias of a shared raw pointer owner") {
+    single_thread_shared_ptr<Pair> p(new Pair);
+    auto c = p;
+    {
+      single_thread_shared_ptr<int> first(p, &p->first);
+      REQUIRE(*first == 1);
+    }
+    REQUIRE(p.use_count() == 2);
+    c.reset();
+    REQUIRE(Pair::dtor_count == 0);
+    p.reset();
+    REQUIRE(Pair::dtor_count == 1);
+  }
+
+  SECTION("Alias of a shared raw pointer owner is never unique") {
+    single_thread_shared_ptr<Pair> p(new Pair);
+    auto c = p;
+    single_thread_shared_ptr<int> second(p, &p->second);
+    REQUIRE_THROWS_AS(second.release_to_thread(), std::logic_error);
+    REQUIRE(second);
+    single_thread_cow<int> cow(second);
+    cow.write() = 5;
+    REQUIRE(p->second == 2);
+    REQUIRE(*cow == 5);
+  }
+
+  SECTION("Rvalue alias of a raw pointer owner observed by a weak pointer") {
+    single_thread_shared_ptr<Pair> p(new Pair);
+    single_thread_weak_ptr<Pair> w(p);
+    auto *pair = p.get();
+    single_thread_shared_ptr<int> second(std::move(p), &pair->second);
+    REQUIRE(!p);
+    REQUIRE(!w.expired());
+    second.reset();
+    REQUIRE(w.expired());
+    REQUIRE(Pair::dtor_count == 1);
+  }
+
+  SECTION("Alias of an empty pointer does not own") {
+    int value = 3;
+    single_thread_shared_ptr<Pair> empty;
+    single_thread_shared_ptr<int> alias(empty, &value);
+    REQUIRE(alias.get() == &value);
+    REQUIRE(alias.use_count() == 0);
+  }
+
+  SECTION("Arrays are deleted as arrays") {
+    {
+      single_thread_shared_ptr<Pair[]> p(new Pair[3]);
+      single_thread_shared_ptr<int> second(p, &p[1].second);
+      p.reset();
+      REQUIRE(*second == 2);
+    }
+    REQUIRE(Pair::dtor_count == 3);
+  }
+
+  SECTION("Arrays of known size are deleted as arrays") {
+    {
+      single_thread_shared_ptr<Pair[3]> p(new Pair[3]);
+      single_thread_shared_ptr<int> second(p, &p[2].second);
+      p.reset();
+      REQUIRE(*second == 2);
+    }
+    REQUIRE(Pair::dtor_count == 3);
+
+    single_thread_shared_ptr<int[4]> a(new int[4]{1, 2, 3, 4});
+    single_thread_shared_ptr<int> third(a, &a[2]);
+    a.reset();
+    REQUIRE(*third == 3);
+  }
+}
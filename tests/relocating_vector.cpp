@@ -0,0 +1,173 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_compact_ptr.hpp>
+#include <single_thread_shared_ptr/single_thread_intrusive_ptr.hpp>
+#include <single_thread_shared_ptr/single_thread_relocating_vector.hpp>
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+struct A {
+  A(int v) : value{v} { ++ctor_count; }
+  A(const A &rhs) : value{rhs.value} { ++ctor_count; }
+  A(A &&rhs) noexcept : value{rhs.value} {
+    ++ctor_count;
+    ++move_count;
+  }
+  A &operator=(A &&rhs) noexcept {
+    value = rhs.value;
+    return *this;
+  }
+  ~A() { ++dtor_count; }
+  int value;
+  static long ctor_count;
+  static long move_count;
+  static long dtor_count;
+};
+long A::ctor_count = 0;
+long A::move_count = 0;
+long A::dtor_count = 0;
+
+// copying the element 2 fails
+struct Fragile : A {
+  Fragile(int v) : A(v) {}
+  Fragile(const Fragile &rhs) : A(rhs) {
+    if (value == 2)
+      throw std::runtime_error("copy");
+  }
+  Fragile(Fragile &&) noexcept = default;
+  Fragile &operator=(Fragile &&) noexcept = default;
+};
+
+struct I : single_thread_intrusive_ref_counter<I> {};
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    A::ctor_count = 0;
+    A::move_count = 0;
+    A::dtor_count = 0;
+  }
+};
+} // namespace
+
+static_assert(single_thread_is_trivially_relocatable_v<int>);
+static_assert(
+    single_thread_is_trivially_relocatable_v<single_thread_shared_ptr<A>>);
+static_assert(
+    single_thread_is_trivially_relocatable_v<single_thread_weak_ptr<A>>);
+static_assert(
+    single_thread_is_trivially_relocatable_v<single_thread_compact_ptr<A>>);
+static_assert(
+    single_thread_is_trivially_relocatable_v<single_thread_intrusive_ptr<I>>);
+static_assert(!single_thread_is_trivially_relocatable_v<A>);
+
+TEST_CASE("single_thread_shared_vector relocates pointers bitwise") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Growth keeps the counts") {
+    {
+      single_thread_shared_vector<A> v;
+      auto first = make_single_thread_shared<A>(0);
+      v.push_back(first);
+      for (int i = 1; i < 1000; ++i)
+        v.push_back(make_single_thread_shared<A>(i));
+      REQUIRE(v.size() == 1000);
+      REQUIRE(v.capacity() >= 1000);
+      REQUIRE(first.use_count() == 2);
+      for (int i = 0; i < 1000; ++i)
+        REQUIRE(v[i]->value == i);
+      REQUIRE(A::ctor_count == 1000);
+      REQUIRE(A::dtor_count == 0);
+    }
+    REQUIRE(A::dtor_count == 1000);
+  }
+
+  SECTION("Sole owners created from raw pointers stay unique") {
+    single_thread_shared_vector<A> v;
+    for (int i = 0; i < 100; ++i)
+      v.emplace_back(new A(i));
+    for (auto &p : v)
+      REQUIRE(p.use_count() == 1);
+  }
+
+  SECTION("Pushing an element of the vector itself") {
+    single_thread_shared_vector<A> v;
+    v.push_back(make_single_thread_shared<A>(7));
+    for (int i = 0; i < 10; ++i)
+      v.push_back(v.front());
+    REQUIRE(v.size() == 11);
+    REQUIRE(v.back()->value == 7);
+    REQUIRE(v.front().use_count() == 11);
+  }
+
+  SECTION("Erase releases the erased elements and closes the gap") {
+    single_thread_shared_vector<A> v;
+    for (int i = 0; i < 10; ++i)
+      v.push_back(make_single_thread_shared<A>(i));
+    auto it = v.erase(v.begin() + 2, v.begin() + 5);
+    REQUIRE(it == v.begin() + 2);
+    REQUIRE(A::dtor_count == 3);
+    REQUIRE(v.size() == 7);
+    REQUIRE((*it)->value == 5);
+    v.erase(v.begin());
+    REQUIRE(v.front()->value == 1);
+    v.erase(v.end() - 1);
+    REQUIRE(v.back()->value == 8);
+    REQUIRE(A::dtor_count == 5);
+  }
+
+  SECTION("Copies, moves and shrinking") {
+    single_thread_shared_vector<A> v;
+    for (int i = 0; i < 5; ++i)
+      v.push_back(make_single_thread_shared<A>(i));
+    auto copy = v;
+    REQUIRE(v[3].use_count() == 2);
+    auto moved = std::move(copy);
+    REQUIRE(copy.empty());
+    REQUIRE(v[3].use_count() == 2);
+    moved.pop_back();
+    moved.shrink_to_fit();
+    REQUIRE(moved.capacity() == 4);
+    REQUIRE(v[4].use_count() == 1);
+    moved.clear();
+    REQUIRE(v[0].use_count() == 1);
+  }
+}
+
+TEST_CASE("single_thread_relocating_vector moves other types one by one") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  {
+    single_thread_relocating_vector<A> v;
+    for (int i = 0; i < 5; ++i)
+      v.emplace_back(i);
+    REQUIRE(A::move_count == 4);
+    v.erase(v.begin() + 1);
+    REQUIRE(v.size() == 4);
+    REQUIRE(v[1].value == 2);
+    REQUIRE(v[3].value == 4);
+
+    single_thread_relocating_vector<std::string> s{"a", "b"};
+    s.push_back(std::string(100, 'c'));
+    s.erase(s.begin());
+    REQUIRE(s.size() == 2);
+    REQUIRE(s[1].size() == 100);
+  }
+  REQUIRE(A::ctor_count == A::dtor_count);
+}
+
+TEST_CASE("single_thread_relocating_vector cleans up a failed copy") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  {
+    single_thread_relocating_vector<Fragile> v;
+    for (int i = 0; i < 4; ++i)
+      v.emplace_back(i);
+    using vector = single_thread_relocating_vector<Fragile>;
+    REQUIRE_THROWS_AS(vector(v), std::runtime_error);
+    REQUIRE_THROWS_AS((vector{Fragile(1), Fragile(2)}), std::runtime_error);
+    REQUIRE(v.size() == 4);
+  }
+  REQUIRE(A::ctor_count == A::dtor_count);
+}
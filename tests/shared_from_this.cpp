@@ -0,0 +1,149 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <memory_resource>
+
+namespace {
+struct A : enable_single_thread_shared_from_this<A> {
+  A() { ++ctor_count; }
+  A(const A &rhs) : enable_single_thread_shared_from_this<A>(rhs) {
+    ++ctor_count;
+  }
+  virtual ~A() { ++dtor_count; }
+  static long ctor_count;
+  static long dtor_count;
+};
+long A::ctor_count = 0;
+long A::dtor_count = 0;
+
+struct B : A {};
+
+struct SelfInDestructor : enable_single_thread_shared_from_this<SelfInDestructor> {
+  ~SelfInDestructor() {
+    try {
+      shared_from_this();
+    } catch (const std::bad_weak_ptr &) {
+      threw = true;
+    }
+  }
+  static bool threw;
+};
+bool SelfInDestructor::threw = false;
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    A::ctor_count = 0;
+    A::dtor_count = 0;
+    SelfInDestructor::threw = false;
+  }
+};
+} // namespace
+
+TEST_CASE("shared_from_this shares the count of the owner") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Object created with make_single_thread_shared") {
+    {
+      auto p = make_single_thread_shared<A>();
+      auto q = p->shared_from_this();
+      REQUIRE(q.get() == p.get());
+      REQUIRE(p.use_count() == 2);
+    }
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Object adopted from a raw pointer") {
+    {
+      single_thread_shared_ptr<A> p(new A);
+      {
+        auto q = p->shared_from_this();
+        REQUIRE(p.use_count() == 2);
+      }
+      REQUIRE(p.use_count() == 1);
+    }
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Object owned with a deleter") {
+    bool deleted = false;
+    {
+      single_thread_shared_ptr<A> p(new A, [&deleted](A *a) {
+        deleted = true;
+        delete a;
+      });
+      auto q = p->shared_from_this();
+      REQUIRE(p.use_count() == 2);
+    }
+    REQUIRE(deleted);
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Object created with allocate_single_thread_shared") {
+    std::pmr::monotonic_buffer_resource resource;
+    {
+      auto p = allocate_single_thread_shared<A>(
+          std::pmr::polymorphic_allocator<A>(&resource));
+      auto q = p->shared_from_this();
+      REQUIRE(p.use_count() == 2);
+    }
+    REQUIRE(A::dtor_count == 1);
+  }
+
+  SECTION("Derived object owned through its own type") {
+    auto p = make_single_thread_shared<B>();
+    single_thread_shared_ptr<A> q = p->shared_from_this();
+    REQUIRE(q.get() == p.get());
+    REQUIRE(p.use_count() == 2);
+  }
+
+  SECTION("Const object") {
+    auto p = make_single_thread_shared<const A>();
+    single_thread_shared_ptr<const A> q = p->shared_from_this();
+    REQUIRE(p.use_count() == 2);
+  }
+
+  SECTION("The object keeps its pointers alive after the owner is gone") {
+    single_thread_shared_ptr<A> q;
+    {
+      auto p = make_single_thread_shared<A>();
+      q = p->shared_from_this();
+    }
+    REQUIRE(A::dtor_count == 0);
+    REQUIRE(q.use_count() == 1);
+  }
+}
+
+TEST_CASE("weak_from_this observes the owner") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  single_thread_weak_ptr<A> w;
+  {
+    auto p = make_single_thread_shared<A>();
+    w = p->weak_from_this();
+    REQUIRE(w.use_count() == 1);
+    REQUIRE(w.lock().get() == p.get());
+  }
+  REQUIRE(w.expired());
+}
+
+TEST_CASE("shared_from_this throws without an owner") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Object not owned by any pointer") {
+    A a;
+    REQUIRE_THROWS_AS(a.shared_from_this(), std::bad_weak_ptr);
+    REQUIRE(a.weak_from_this().expired());
+  }
+
+  SECTION("Copies do not take over the owner") {
+    auto p = make_single_thread_shared<A>();
+    A copy{*p};
+    REQUIRE_THROWS_AS(copy.shared_from_this(), std::bad_weak_ptr);
+  }
+
+  SECTION("Object being destroyed by its last owner") {
+    { single_thread_shared_ptr<SelfInDestructor> p(new SelfInDestructor); }
+    REQUIRE(SelfInDestructor::threw);
+  }
+}
@@ -0,0 +1,220 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_shared_pool.hpp>
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+struct Message {
+  Message() { ++ctor_count; }
+  explicit Message(int v) : id{v} { ++ctor_count; }
+  ~Message() { ++dtor_count; }
+  int id{0};
+  std::string payload;
+  static long ctor_count;
+  static long dtor_count;
+};
+long Message::ctor_count = 0;
+long Message::dtor_count = 0;
+
+struct Throwing {
+  explicit Throwing(bool fail) {
+    if (fail)
+      throw std::runtime_error("construction failed");
+  }
+};
+
+struct Node : enable_single_thread_shared_from_this<Node> {
+  int id{0};
+};
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    Message::ctor_count = 0;
+    Message::dtor_count = 0;
+  }
+};
+} // namespace
+
+TEST_CASE("single_thread_shared_pool recycles blocks") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Released objects are destroyed and their blocks reused") {
+    single_thread_shared_pool<Message> pool;
+    Message *first;
+    {
+      auto p = pool.make(1);
+      first = p.get();
+      REQUIRE(pool.outstanding() == 1);
+      auto c = p;
+      REQUIRE(p.use_count() == 2);
+    }
+    REQUIRE(Message::dtor_count == 1);
+    REQUIRE(pool.size() == 1);
+    REQUIRE(pool.outstanding() == 0);
+
+    auto q = pool.make(2);
+    REQUIRE(q.get() == first);
+    REQUIRE(q->id == 2);
+    REQUIRE(q.use_count() == 1);
+    REQUIRE(pool.size() == 0);
+
+    auto stats = pool.stats();
+    REQUIRE(stats.misses == 1);
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.recycled == 1);
+    REQUIRE(stats.discarded == 0);
+  }
+
+  SECTION("Weak pointers keep the block out of the pool") {
+    single_thread_shared_pool<Message> pool;
+    auto p = pool.make();
+    single_thread_weak_ptr<Message> w(p);
+    p.reset();
+    REQUIRE(w.expired());
+    REQUIRE(Message::dtor_count == 1);
+    REQUIRE(pool.size() == 0);
+    w.reset();
+    REQUIRE(pool.size() == 1);
+  }
+
+  SECTION("Capacity limits the free list") {
+    single_thread_shared_pool<Message> pool(2);
+    {
+      auto a = pool.make();
+      auto b = pool.make();
+      auto c = pool.make();
+    }
+    REQUIRE(pool.size() == 2);
+    REQUIRE(pool.stats().discarded == 1);
+    pool.set_capacity(1);
+    REQUIRE(pool.size() == 1);
+    pool.trim();
+    REQUIRE(pool.size() == 0);
+    pool.reserve(5);
+    REQUIRE(pool.size() == 1);
+    pool.reset_stats();
+    REQUIRE(pool.stats().misses == 0);
+  }
+
+  SECTION("Failed construction returns the block") {
+    single_thread_shared_pool<Throwing> pool;
+    pool.reserve(1);
+    REQUIRE_THROWS_AS(pool.make(true), std::runtime_error);
+    REQUIRE(pool.size() == 1);
+    REQUIRE_THROWS_AS(pool.make(true), std::runtime_error);
+    REQUIRE(pool.stats().hits == 0);
+    REQUIRE(pool.stats().misses == 0);
+    REQUIRE(pool.make(false));
+    REQUIRE(pool.stats().hits == 1);
+  }
+
+  SECTION("Failed construction keeps the free list within the capacity") {
+    single_thread_shared_pool<Throwing> pool(0);
+    REQUIRE_THROWS_AS(pool.make(true), std::runtime_error);
+    REQUIRE(pool.size() == 0);
+    REQUIRE(pool.outstanding() == 0);
+  }
+
+  SECTION("Misses are counted once the object is handed out") {
+    single_thread_shared_pool<Throwing> pool;
+    REQUIRE_THROWS_AS(pool.make(true), std::runtime_error);
+    REQUIRE(pool.stats().misses == 0);
+    REQUIRE(pool.size() == 1);
+    auto p = pool.make(false);
+    REQUIRE(pool.stats().hits == 1);
+    REQUIRE(pool.stats().misses == 0);
+    auto q = pool.make(false);
+    REQUIRE(pool.stats().misses == 1);
+  }
+
+  SECTION("Pools of const objects") {
+    single_thread_shared_pool<const Message> pool;
+    const Message *first;
+    {
+      auto p = pool.make(3);
+      first = p.get();
+      REQUIRE(p->id == 3);
+    }
+    auto q = pool.acquire();
+    REQUIRE(q.get() == first);
+    REQUIRE(q->id == 0);
+    REQUIRE(pool.stats().hits == 1);
+  }
+
+  SECTION("Objects outlive the pool") {
+    single_thread_shared_ptr<Message> survivor;
+    {
+      single_thread_shared_pool<Message> pool;
+      pool.reserve(3);
+      survivor = pool.make(7);
+    }
+    REQUIRE(survivor->id == 7);
+    REQUIRE(Message::dtor_count == 0);
+    survivor.reset();
+    REQUIRE(Message::dtor_count == 1);
+  }
+}
+
+TEST_CASE("single_thread_shared_pool with a reset function keeps objects") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  single_thread_shared_pool<Message> pool(16, [](Message &m) {
+    m.id = 0;
+    m.payload.clear();
+  });
+
+  {
+    auto p = pool.acquire();
+    p->id = 3;
+    p->payload.assign(100, 'x');
+  }
+  REQUIRE(Message::ctor_count == 1);
+  REQUIRE(Message::dtor_count == 0);
+
+  {
+    auto p = pool.acquire();
+    REQUIRE(p->id == 0);
+    REQUIRE(p->payload.empty());
+    REQUIRE(p->payload.capacity() >= 100);
+    REQUIRE(Message::ctor_count == 1);
+  }
+
+  {
+    // make() replaces the kept object
+    auto p = pool.make(9);
+    REQUIRE(p->id == 9);
+    REQUIRE(Message::ctor_count == 2);
+    REQUIRE(Message::dtor_count == 1);
+  }
+
+  pool.trim();
+  REQUIRE(Message::dtor_count == 2);
+}
+
+TEST_CASE("single_thread_shared_pool keeps objects sharing themselves") {
+  single_thread_shared_pool<Node> pool(4, [](Node &n) { n.id = 0; });
+  Node *first;
+  {
+    auto p = pool.acquire();
+    first = p.get();
+    p->id = 1;
+    auto self = p->shared_from_this();
+    REQUIRE(self.get() == first);
+  }
+  REQUIRE(pool.outstanding() == 0);
+  REQUIRE(pool.stats().recycled == 1);
+
+  auto q = pool.acquire();
+  REQUIRE(q.get() == first);
+  REQUIRE(q->id == 0);
+  REQUIRE(pool.stats().hits == 1);
+  REQUIRE(q->shared_from_this() == q);
+  single_thread_weak_ptr<Node> w = q->weak_from_this();
+  q.reset();
+  REQUIRE(w.expired());
+  REQUIRE(pool.outstanding() == 1);
+  w.reset();
+  REQUIRE(pool.outstanding() == 0);
+}
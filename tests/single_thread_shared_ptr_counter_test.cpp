@@ -2,45 +2,24 @@
 
 #include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
 
-#include <atomic>
+#include <alloc_tracking.hpp>
+
 using namespace std;
 
 namespace {
+// allocations of the calling thread inside call()
 class OperatorNewSpy {
 public:
-  static inline std::atomic<uint32_t> _new_counter{0};
-    static inline std::atomic<uint32_t> _delete_counter{0};
-  static inline std::atomic<bool> _lock{true};
-
-public:
-  OperatorNewSpy() {
-    _new_counter = 0;
-    _lock = true;
-  }
-
   template <typename Callable> void call(Callable &&c) {
-    _lock = false;
-    c();
-    _lock = true;
+    _counts += alloc_tracking::measure(std::forward<Callable>(c));
   }
 
-  uint32_t countNewCalls() const { return _new_counter.load(); }
-  uint32_t countDeleteCalls() const { return _new_counter.load(); }
-};
-}
-
-void *operator new(size_t size) {
-  if (!OperatorNewSpy::_lock)
-    OperatorNewSpy::_new_counter++;
-  void *p = malloc(size);
-  return p;
-}
+  uint64_t countNewCalls() const { return _counts.allocations; }
+  uint64_t countDeleteCalls() const { return _counts.frees; }
 
-void operator delete(void * p) noexcept
-{
-    if (!OperatorNewSpy::_lock)
-        OperatorNewSpy::_delete_counter++;
-    free(p);
+private:
+  alloc_tracking::Counts _counts;
+};
 }
 
 TEST_CASE("single_thread_shared_ptr_counter construction") {
@@ -98,3 +77,186 @@ TEST_CASE("single_thread_shared_ptr_counter construction") {
       REQUIRE(c2.count() == 2);
   }
 }
+
+TEST_CASE("make_single_thread_shared allocation count") {
+  OperatorNewSpy spy;
+
+  SECTION("Object and counter share one allocation") {
+    spy.call([]() { [[maybe_unused]] auto p = make_single_thread_shared<int>(1); });
+    REQUIRE(spy.countNewCalls() == 1);
+    REQUIRE(spy.countDeleteCalls() == 1);
+  }
+
+  SECTION("Copies do not allocate") {
+    auto p = make_single_thread_shared<int>(1);
+    spy.call([&]() {
+      [[maybe_unused]] auto p2{p};
+      [[maybe_unused]] auto p3{p2};
+      p3 = p;
+    });
+    REQUIRE(spy.countNewCalls() == 0);
+    REQUIRE(p.use_count() == 1);
+  }
+
+  SECTION("Copies of raw pointer owners still promote the counter") {
+    single_thread_shared_ptr<int> p(new int(1));
+    spy.call([&]() { [[maybe_unused]] auto p2{p}; });
+    REQUIRE(spy.countNewCalls() == 1);
+  }
+}
+
+TEST_CASE("single_thread_weak_ptr allocation count") {
+  OperatorNewSpy spy;
+
+  SECTION("Sole owner without weak pointers does not allocate") {
+    spy.call([]() {
+      single_thread_shared_ptr<int> p(nullptr);
+      auto p2 = std::move(p);
+    });
+    REQUIRE(spy.countNewCalls() == 0);
+  }
+
+  SECTION("First weak pointer promotes the counter") {
+    single_thread_shared_ptr<int> p(new int(1));
+    spy.call([&]() {
+      single_thread_weak_ptr<int> w1(p);
+      single_thread_weak_ptr<int> w2(p);
+      single_thread_weak_ptr<int> w3(w1);
+    });
+    REQUIRE(spy.countNewCalls() == 1);
+  }
+
+  SECTION("Weak pointers to a co-allocated object do not allocate") {
+    auto p = make_single_thread_shared<int>(1);
+    spy.call([&]() {
+      single_thread_weak_ptr<int> w(p);
+      [[maybe_unused]] auto locked = w.lock();
+    });
+    REQUIRE(spy.countNewCalls() == 0);
+  }
+}
+
+namespace {
+struct Self : enable_single_thread_shared_from_this<Self> {};
+} // namespace
+
+TEST_CASE("shared_from_this allocation count") {
+  OperatorNewSpy spy;
+
+  SECTION("Co-allocated object does not allocate") {
+    auto p = make_single_thread_shared<Self>();
+    spy.call([&]() {
+      [[maybe_unused]] auto p2 = p->shared_from_this();
+      [[maybe_unused]] auto w = p->weak_from_this();
+    });
+    REQUIRE(spy.countNewCalls() == 0);
+  }
+
+  SECTION("Raw pointer owner allocates its counter once") {
+    spy.call([]() {
+      single_thread_shared_ptr<Self> p(new Self);
+      [[maybe_unused]] auto p2 = p->shared_from_this();
+      [[maybe_unused]] auto p3 = p2;
+    });
+    REQUIRE(spy.countNewCalls() == 2);
+    REQUIRE(spy.countDeleteCalls() == 2);
+  }
+}
+
+TEST_CASE("single_thread_shared_ptr_counter reclaims the heap counter") {
+  OperatorNewSpy spy;
+
+  SECTION("Survivor goes back inline when asked to") {
+    single_thread_shared_ptr_counter c1{};
+    { [[maybe_unused]] auto c2{c1}; }
+    REQUIRE(c1.isLast());
+    REQUIRE(c1.count() == 1);
+    REQUIRE(c1.isGlobalCounter());
+    REQUIRE(c1.reclaim());
+    REQUIRE(!c1.isGlobalCounter());
+    REQUIRE(c1.count() == 1);
+  }
+
+  SECTION("Shared counters are not reclaimed") {
+    single_thread_shared_ptr_counter c1{};
+    auto c2{c1};
+    REQUIRE(!c1.reclaim());
+    REQUIRE(c1.count() == 2);
+  }
+
+  SECTION("reclaim_counter of a survivor frees its counter") {
+    single_thread_shared_ptr<int> p(new int(1));
+    { [[maybe_unused]] auto c{p}; }
+    spy.call([&]() { REQUIRE(p.reclaim_counter()); });
+    REQUIRE(spy.countDeleteCalls() == 1);
+    REQUIRE(p.use_count() == 1);
+    spy.call([&]() { [[maybe_unused]] auto c{p}; });
+    REQUIRE(spy.countNewCalls() == 1);
+  }
+
+  SECTION("Survivor copied again keeps its counter") {
+    single_thread_shared_ptr<int> p(new int(1));
+    { [[maybe_unused]] auto c{p}; }
+    spy.call([&]() { [[maybe_unused]] auto c{p}; });
+    REQUIRE(spy.countNewCalls() == 0);
+    REQUIRE(spy.countDeleteCalls() == 0);
+  }
+
+  SECTION("Counters with weak references stay on the heap") {
+    single_thread_shared_ptr<int> p(new int(1));
+    single_thread_weak_ptr<int> w(p);
+    REQUIRE(!p.reclaim_counter());
+    REQUIRE(w.use_count() == 1);
+    p.reset();
+    REQUIRE(w.expired());
+  }
+
+  SECTION("Co-allocated blocks stay where they are") {
+    auto p = make_single_thread_shared<int>(1);
+    { [[maybe_unused]] auto c{p}; }
+    REQUIRE(!p.reclaim_counter());
+    single_thread_weak_ptr<int> w(p);
+    REQUIRE(w.use_count() == 1);
+  }
+}
+
+namespace {
+struct Base {
+  virtual ~Base() = default;
+  int value{1};
+};
+struct Derived : Base {};
+} // namespace
+
+TEST_CASE("pointer casts allocation count") {
+  OperatorNewSpy spy;
+
+  SECTION("Moving a sole owner through casts does not allocate") {
+    single_thread_shared_ptr<Base> p(new Derived);
+    spy.call([&]() {
+      auto d = static_pointer_cast<Derived>(std::move(p));
+      auto c = const_pointer_cast<const Derived>(std::move(d));
+      auto b = dynamic_pointer_cast<const Base>(std::move(c));
+      REQUIRE(b.use_count() == 1);
+    });
+    REQUIRE(spy.countNewCalls() == 0);
+  }
+
+  SECTION("Moving a managed block into an alias does not allocate") {
+    auto p = make_single_thread_shared<Base>();
+    spy.call([&]() {
+      single_thread_shared_ptr<int> v(std::move(p), &p->value);
+      REQUIRE(v.use_count() == 1);
+    });
+    REQUIRE(spy.countNewCalls() == 0);
+  }
+
+  SECTION("An alias of a sole owner allocates one block") {
+    single_thread_shared_ptr<Base> p(new Base);
+    spy.call([&]() {
+      single_thread_shared_ptr<int> v(p, &p->value);
+      [[maybe_unused]] auto c = v;
+    });
+    REQUIRE(spy.countNewCalls() == 1);
+  }
+}
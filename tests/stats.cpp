@@ -0,0 +1,86 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <thread>
+
+// built into its own executable with SINGLE_THREAD_SHARED_PTR_STATS defined
+static_assert(single_thread_shared_ptr_statistics::enabled,
+              "statistics are enabled for this test");
+
+using stats = single_thread_shared_ptr_statistics;
+
+TEST_CASE("single_thread_shared_ptr_statistics records events") {
+  stats::reset();
+
+  SECTION("Sole owner does not touch the counters") {
+    { single_thread_shared_ptr<int> p(new int(1)); }
+    auto s = stats::get();
+    REQUIRE(s.promotions == 0);
+    REQUIRE(s.counter_allocations == 0);
+    REQUIRE(s.object_deletes == 1);
+  }
+
+  SECTION("Copy promotes and the last owner frees the counter") {
+    {
+      single_thread_shared_ptr<int> p(new int(1));
+      auto c1 = p;
+      auto c2 = p;
+      REQUIRE(stats::get().promotions == 1);
+      REQUIRE(stats::get().live_counters == 1);
+    }
+    auto s = stats::get();
+    REQUIRE(s.counter_allocations == 1);
+    REQUIRE(s.counter_frees == 1);
+    REQUIRE(s.object_deletes == 1);
+    REQUIRE(s.live_counters == 0);
+    REQUIRE(s.peak_live_counters == 1);
+  }
+
+  SECTION("Survivor reclaims its counter") {
+    single_thread_shared_ptr<int> p(new int(1));
+    { auto c = p; }
+    REQUIRE(stats::get().live_counters == 1);
+    REQUIRE(p.reclaim_counter());
+    auto s = stats::get();
+    REQUIRE(s.reclaims == 1);
+    REQUIRE(s.counter_frees == 1);
+    REQUIRE(s.live_counters == 0);
+  }
+
+  SECTION("Co-allocated blocks are counted without a promotion") {
+    { auto p = make_single_thread_shared<int>(1); }
+    auto s = stats::get();
+    REQUIRE(s.promotions == 0);
+    REQUIRE(s.counter_allocations == 1);
+    REQUIRE(s.counter_frees == 1);
+    REQUIRE(s.object_deletes == 1);
+  }
+
+  SECTION("Peak of live counters") {
+    {
+      auto p1 = make_single_thread_shared<int>(1);
+      auto p2 = make_single_thread_shared<int>(2);
+      single_thread_shared_ptr<int> p3(new int(3));
+      auto c = p3;
+    }
+    auto p4 = make_single_thread_shared<int>(4);
+    auto s = stats::get();
+    REQUIRE(s.peak_live_counters == 3);
+    REQUIRE(s.live_counters == 1);
+  }
+
+  SECTION("Empty pointers are not counted as deletes") {
+    single_thread_shared_ptr<int> p;
+    p = single_thread_shared_ptr<int>();
+    REQUIRE(stats::get().object_deletes == 0);
+  }
+
+  SECTION("Statistics are per thread") {
+    { auto p = make_single_thread_shared<int>(1); }
+    single_thread_shared_ptr_stats other;
+    std::thread([&] { other = stats::get(); }).join();
+    REQUIRE(other.counter_allocations == 0);
+    REQUIRE(stats::get().counter_allocations == 1);
+  }
+}
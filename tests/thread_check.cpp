@@ -0,0 +1,82 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+// built into its own executable with SINGLE_THREAD_SHARED_PTR_THREAD_CHECK
+namespace {
+struct recorded_violation {
+  std::string operation;
+  const void *block;
+  std::thread::id owner;
+  std::thread::id current;
+};
+
+std::vector<recorded_violation> violations;
+
+void record(const single_thread_shared_ptr_thread_violation &v) {
+  violations.push_back({v.operation, v.block, v.owner, v.current});
+}
+
+struct handler_guard {
+  handler_guard() {
+    violations.clear();
+    previous = single_thread_shared_ptr_thread_check::setHandler(&record);
+  }
+  ~handler_guard() { single_thread_shared_ptr_thread_check::setHandler(previous); }
+  single_thread_shared_ptr_thread_check::handler_fn previous;
+};
+} // namespace
+
+TEST_CASE("single_thread_shared_ptr_thread_check reports foreign threads") {
+  handler_guard guard;
+
+  SECTION("Use on the owning thread is fine") {
+    auto p = make_single_thread_shared<int>(1);
+    auto c = p;
+    single_thread_weak_ptr<int> w(c);
+    c.reset();
+    REQUIRE(w.lock() == p);
+    REQUIRE(violations.empty());
+  }
+
+  SECTION("Sole owner may be moved to another thread") {
+    single_thread_shared_ptr<int> p(new int(1));
+    std::thread([p = std::move(p)]() mutable { p.reset(); }).join();
+    REQUIRE(violations.empty());
+  }
+
+  SECTION("Copy on another thread") {
+    auto p = make_single_thread_shared<int>(1);
+    std::thread([&] { auto c = p; }).join();
+    REQUIRE(violations.size() == 2);
+    REQUIRE(violations[0].operation == "copy");
+    REQUIRE(violations[1].operation == "release");
+    REQUIRE(violations[0].owner == std::this_thread::get_id());
+    REQUIRE(violations[0].current != std::this_thread::get_id());
+  }
+
+  SECTION("Delete on another thread") {
+    single_thread_shared_ptr<int> p(new int(1));
+    auto c = p;
+    std::thread([&] { c.reset(); }).join();
+    REQUIRE(violations.size() == 1);
+    REQUIRE(violations[0].operation == "release");
+
+    std::thread([&] { p.reset(); }).join();
+    REQUIRE(violations.size() == 3);
+    REQUIRE(violations[1].operation == "delete");
+    REQUIRE(violations[2].operation == "release");
+  }
+
+  SECTION("Weak pointers are checked") {
+    auto p = make_single_thread_shared<int>(1);
+    single_thread_weak_ptr<int> w(p);
+    std::thread([&] { auto l = w.lock(); }).join();
+    REQUIRE(!violations.empty());
+    REQUIRE(violations[0].operation == "lock");
+  }
+}
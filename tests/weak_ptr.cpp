@@ -0,0 +1,153 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <single_thread_shared_ptr/single_thread_shared_ptr.hpp>
+
+namespace {
+struct A {
+  A() { ++ctor_count; }
+  virtual ~A() { ++dtor_count; }
+  static long ctor_count;
+  static long dtor_count;
+};
+long A::ctor_count = 0;
+long A::dtor_count = 0;
+
+struct B : A {};
+
+struct reset_count_struct {
+  ~reset_count_struct() {
+    A::ctor_count = 0;
+    A::dtor_count = 0;
+  }
+};
+
+// releases a weak reference to itself from the destructor
+struct self_observer {
+  ~self_observer() { self.reset(); }
+  single_thread_weak_ptr<self_observer> self;
+};
+} // namespace
+
+TEST_CASE("single_thread_weak_ptr construction") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Default constructed pointer is expired") {
+    single_thread_weak_ptr<A> w;
+    REQUIRE(w.expired());
+    REQUIRE(w.use_count() == 0);
+    REQUIRE(w.lock().get() == nullptr);
+  }
+
+  SECTION("Weak pointer from empty shared pointer is expired") {
+    single_thread_shared_ptr<A> p;
+    single_thread_weak_ptr<A> w(p);
+    REQUIRE(w.expired());
+  }
+
+  SECTION("Weak pointer does not own the object") {
+    single_thread_shared_ptr<A> p(new A);
+    single_thread_weak_ptr<A> w(p);
+    REQUIRE(p.use_count() == 1);
+    REQUIRE(w.use_count() == 1);
+    REQUIRE(!w.expired());
+  }
+
+  SECTION("Weak pointer from a derived class pointer") {
+    auto p = make_single_thread_shared<B>();
+    single_thread_weak_ptr<A> w(p);
+    REQUIRE(w.lock().get() == p.get());
+  }
+
+  SECTION("Copy and move") {
+    single_thread_shared_ptr<A> p(new A);
+    single_thread_weak_ptr<A> w1(p);
+    single_thread_weak_ptr<A> w2(w1);
+    single_thread_weak_ptr<A> w3(std::move(w1));
+    REQUIRE(w1.expired());
+    REQUIRE(w2.lock() == p);
+    REQUIRE(w3.lock() == p);
+  }
+}
+
+TEST_CASE("single_thread_weak_ptr observes the object lifetime") {
+  reset_count_struct __attribute__((unused)) reset;
+
+  SECTION("Raw pointer owner") {
+    single_thread_weak_ptr<A> w;
+    {
+      single_thread_shared_ptr<A> p(new A);
+      w = p;
+      auto locked = w.lock();
+      REQUIRE(locked.get() == p.get());
+      REQUIRE(p.use_count() == 2);
+    }
+    REQUIRE(A::dtor_count == 1);
+    REQUIRE(w.expired());
+    REQUIRE(w.lock().get() == nullptr);
+  }
+
+  SECTION("make_single_thread_shared owner") {
+    single_thread_weak_ptr<A> w;
+    {
+      auto p = make_single_thread_shared<A>();
+      w = p;
+      REQUIRE(w.use_count() == 1);
+    }
+    REQUIRE(A::dtor_count == 1);
+    REQUIRE(w.expired());
+  }
+
+  SECTION("Locked pointer keeps the object alive") {
+    single_thread_shared_ptr<A> locked;
+    {
+      auto p = make_single_thread_shared<A>();
+      single_thread_weak_ptr<A> w(p);
+      locked = w.lock();
+    }
+    REQUIRE(A::dtor_count == 0);
+    REQUIRE(locked.use_count() == 1);
+  }
+
+  SECTION("Constructing from an expired pointer throws") {
+    single_thread_weak_ptr<A> w;
+    { w = make_single_thread_shared<A>(); }
+    REQUIRE_THROWS_AS(single_thread_shared_ptr<A>(w), std::bad_weak_ptr);
+  }
+
+  SECTION("Object can drop a weak reference to itself") {
+    auto p = make_single_thread_shared<self_observer>();
+    p->self = p;
+    p.reset();
+    single_thread_shared_ptr<self_observer> raw(new self_observer);
+    raw->self = raw;
+    raw.reset();
+  }
+
+  REQUIRE(A::ctor_count == A::dtor_count);
+}
+
+TEST_CASE("single_thread_weak_ptr modifiers") {
+  SECTION("reset") {
+    auto p = make_single_thread_shared<int>(1);
+    single_thread_weak_ptr<int> w(p);
+    w.reset();
+    REQUIRE(w.expired());
+    REQUIRE(p.use_count() == 1);
+  }
+
+  SECTION("swap") {
+    auto p1 = make_single_thread_shared<int>(1);
+    auto p2 = make_single_thread_shared<int>(2);
+    single_thread_weak_ptr<int> w1(p1), w2(p2);
+    w1.swap(w2);
+    REQUIRE(*w1.lock() == 2);
+    REQUIRE(*w2.lock() == 1);
+  }
+
+  SECTION("owner_before") {
+    auto p = make_single_thread_shared<int>(1);
+    single_thread_weak_ptr<int> w1(p), w2(p);
+    REQUIRE(!w1.owner_before(w2));
+    REQUIRE(!w2.owner_before(w1));
+  }
+}